@@ -0,0 +1,214 @@
+#include "benchmarks.h"
+
+#include <filesystem>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_search_server.h"
+#include "log_duration.h"
+#include "process_queries.h"
+#include "search_server.h"
+#include "stop_word_set.h"
+#include "write_ahead_log.h"
+
+using std::string;
+using std::vector;
+using std::cerr;
+using std::endl;
+using std::operator""s;
+
+namespace {
+
+vector<string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        const int length = std::uniform_int_distribution(1, max_length)(generator);
+        string word(length, ' ');
+        for (char& c : word) {
+            c = static_cast<char>(std::uniform_int_distribution('a', 'z')(generator));
+        }
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+vector<string> GenerateDocuments(std::mt19937& generator, const vector<string>& dictionary, int document_count, int max_word_count) {
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        const int word_count = std::uniform_int_distribution(1, max_word_count)(generator);
+        string document;
+        for (int j = 0; j < word_count; ++j) {
+            document += dictionary[std::uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+            document += ' ';
+        }
+        documents.push_back(std::move(document));
+    }
+    return documents;
+}
+
+} // namespace
+
+void BenchmarkWriteAheadLog() {
+    std::mt19937 generator(5489);
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateDocuments(generator, dictionary, 20'000, 50);
+    const string log_path = (std::filesystem::temp_directory_path() / "search_server_wal_benchmark.log"s).string();
+    const int writer_count = 8;
+    
+    {
+        LOG_DURATION("ingest without log"s);
+        SearchServer server("and with"s);
+        for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    std::filesystem::remove(log_path);
+    {
+        LOG_DURATION("ingest with log, 1 writer, fsync per record"s);
+        SearchServer server("and with"s);
+        server.SetWriteAheadLog(std::make_shared<WriteAheadLog>(log_path));
+        for (int id = 0; id < 2'000; ++id) {
+            server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    std::filesystem::remove(log_path);
+    {
+        auto log = std::make_shared<WriteAheadLog>(log_path);
+        {
+            LOG_DURATION("ingest with log, 8 writers, group commit"s);
+            ConcurrentSearchServer server(SearchServer("and with"s));
+            server.SetWriteAheadLog(log);
+            vector<std::thread> writers;
+            for (int writer = 0; writer < writer_count; ++writer) {
+                writers.emplace_back([&, writer] {
+                    for (int id = writer; id < static_cast<int>(documents.size()); id += writer_count) {
+                        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+                    }
+                });
+            }
+            for (auto& writer : writers) {
+                writer.join();
+            }
+            server.Publish();
+        }
+        cerr << "  records: "s << log->GetRecordCount() << ", fsyncs: "s << log->GetSyncCount() << endl;
+    }
+    for (const size_t thread_count : {size_t{1}, size_t{std::max(1u, std::thread::hardware_concurrency())}}) {
+        ThreadPool thread_pool(thread_count);
+        LOG_DURATION("replay "s + std::to_string(documents.size()) + " records, "s + std::to_string(thread_count) + " decode threads"s);
+        SearchServer server("and with"s);
+        ReplayWriteAheadLog(log_path, server, thread_pool);
+    }
+    std::filesystem::remove(log_path);
+}
+
+void BenchmarkRemoveDuplicates() {
+    std::mt19937 generator(5489);
+    const auto dictionary = GenerateDictionary(generator, 100, 6);
+    //few words from a small dictionary, so that many documents are duplicates
+    const auto documents = GenerateDocuments(generator, dictionary, 200'000, 3);
+    SearchServer server("and with"s);
+    server.SetMutableSegmentLimit(16'384);
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1});
+    }
+    LOG_DURATION("find duplicates among "s + std::to_string(documents.size()) + " documents"s);
+    const auto duplicate_ids = server.FindDuplicateDocumentIds();
+    cerr << "  duplicates: "s << duplicate_ids.size() << endl;
+}
+
+void BenchmarkProcessQueries() {
+    std::mt19937 generator(5489);
+    const auto dictionary = GenerateDictionary(generator, 2'000, 25);
+    const auto documents = GenerateDocuments(generator, dictionary, 20'000, 10);
+    const auto queries = GenerateDocuments(generator, dictionary, 2'000, 7);
+    vector<NewDocument> new_documents;
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        new_documents.push_back({id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    SearchServer server(dictionary[0]);
+    {
+        LOG_DURATION("bulk ingestion of "s + std::to_string(documents.size()) + " documents"s);
+        server.AddDocuments(new_documents);
+    }
+    {
+        LOG_DURATION("sequential queries"s);
+        for (const string& query : queries) {
+            server.FindTopDocuments(query);
+        }
+    }
+    {
+        LOG_DURATION("ProcessQueries, "s + std::to_string(GetDefaultThreadPool().GetThreadCount()) + " threads"s);
+        ProcessQueries(server, queries);
+    }
+    const ThreadPoolStats stats = GetDefaultThreadPool().GetStats();
+    cerr << "  tasks: "s << stats.executed_tasks << ", stolen: "s << stats.stolen_tasks << endl;
+}
+
+void BenchmarkStopWords() {
+    std::mt19937 generator(5489);
+    const auto dictionary = GenerateDictionary(generator, 1'200, 12);
+    const std::set<string> stop_word_tree(dictionary.begin(), dictionary.begin() + 600);
+    const StopWordSet stop_words(stop_word_tree);
+    const auto lookups = GenerateDocuments(generator, dictionary, 20'000, 50);
+    size_t found = 0;
+    {
+        LOG_DURATION("std::set lookups"s);
+        for (const string& text : lookups) {
+            for (size_t begin = 0, end = 0; begin < text.size(); begin = end + 1) {
+                end = std::min(text.find(' ', begin), text.size());
+                found += stop_word_tree.count(text.substr(begin, end - begin));
+            }
+        }
+    }
+    {
+        LOG_DURATION("StopWordSet lookups"s);
+        for (const string& text : lookups) {
+            const std::string_view view = text;
+            for (size_t begin = 0, end = 0; begin < view.size(); begin = end + 1) {
+                end = std::min(view.find(' ', begin), view.size());
+                found -= stop_words.Contains(view.substr(begin, end - begin));
+            }
+        }
+    }
+    cerr << "  stop words: "s << stop_words.GetSize() << ", table bytes: "s << stop_words.GetMemoryBytes()
+         << (found == 0 ? ""s : ", MISMATCH"s) << endl;
+}
+
+void BenchmarkTieredStorage() {
+    std::mt19937 generator(5489);
+    const auto dictionary = GenerateDictionary(generator, 20'000, 10);
+    const auto documents = GenerateDocuments(generator, dictionary, 20'000, 50);
+    //queries use a small part of the vocabulary, as the real long tail is rarely queried
+    const vector<string> queried_words(dictionary.begin(), dictionary.begin() + 500);
+    const auto queries = GenerateDocuments(generator, queried_words, 5'000, 5);
+    SearchServer server("and with"s);
+    server.SetMutableSegmentLimit(4'096);
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1});
+    }
+    server.RebuildSegments();
+    auto run_queries = [&](const string& name) {
+        LOG_DURATION(name + ", resident: "s + std::to_string(server.GetMemoryStats().GetTotalBytes()) + " bytes"s);
+        for (const string& query : queries) {
+            server.FindTopDocuments(query);
+        }
+    };
+    run_queries("all postings in memory"s);
+    server.EnableTieredStorage(std::filesystem::temp_directory_path().string(), 512 * 1024);
+    run_queries("512 KiB hot tier, promotion by counters"s);
+    cerr << "  cold postings: "s << server.GetMemoryStats().cold_postings.objects << endl;
+}
+
+void RunBenchmarks() {
+    BenchmarkWriteAheadLog();
+    BenchmarkRemoveDuplicates();
+    BenchmarkProcessQueries();
+    BenchmarkStopWords();
+    BenchmarkTieredStorage();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Benchmarks are run with `cpp-search-server --benchmark`, results go to std::cerr
+void BenchmarkWriteAheadLog();
+void BenchmarkRemoveDuplicates();
+void BenchmarkProcessQueries();
+void BenchmarkStopWords();
+void BenchmarkTieredStorage();
+void RunBenchmarks();
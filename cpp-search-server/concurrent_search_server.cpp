@@ -0,0 +1,176 @@
+#include "concurrent_search_server.h"
+
+using std::vector;
+using std::string;
+using std::shared_ptr;
+
+//************* Class Concurrent Search Server *************//
+//====== Constructors ==============================
+ConcurrentSearchServer::ConcurrentSearchServer(SearchServer initial_server)
+: published_(std::make_shared<const SearchServer>(std::move(initial_server)))
+, published_version_(0) {
+}
+
+ConcurrentSearchServer::~ConcurrentSearchServer() {
+    StopBackgroundMerging();
+}
+
+//====== Readers (lock-free): =======================
+shared_ptr<const SearchServer> ConcurrentSearchServer::GetSnapshot() const {
+    return published_.load();
+}
+
+uint64_t ConcurrentSearchServer::GetPublishedVersion() const {
+    return published_version_.load(std::memory_order_acquire);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return GetSnapshot()->GetDocumentCount();
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(const string& raw_query, DocumentStatus status) const {
+    const auto snapshot = GetSnapshot();
+    return snapshot->FindTopDocuments(raw_query, status);
+}
+
+vector<Document> ConcurrentSearchServer::FindTopDocuments(const string& raw_query) const {
+    const auto snapshot = GetSnapshot();
+    return snapshot->FindTopDocuments(raw_query);
+}
+
+std::tuple<vector<string>, DocumentStatus> ConcurrentSearchServer::MatchDocument(const string& raw_query, int document_id) const {
+    const auto snapshot = GetSnapshot();
+    return snapshot->MatchDocument(raw_query, document_id);
+}
+
+//====== Writers: ===================================
+void ConcurrentSearchServer::AddDocument(int document_id, const string& document, DocumentStatus status,
+                                         const vector<int>& ratings) {
+    uint64_t sequence_number = 0;
+    {
+        std::lock_guard guard(writer_mutex_);
+        SearchServer& staging = GetStaging();
+        staging.AddDocument(document_id, document, status, ratings);
+        if (write_ahead_log_) {
+            sequence_number = write_ahead_log_->Enqueue({WalRecord::Kind::ADD_DOCUMENT, document_id, status, ratings, document});
+            staging.SetLogSequenceNumber(sequence_number);
+        }
+    }
+    if (write_ahead_log_) {
+        write_ahead_log_->WaitDurable(sequence_number);
+    }
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    uint64_t sequence_number = 0;
+    {
+        std::lock_guard guard(writer_mutex_);
+        SearchServer& staging = GetStaging();
+        staging.RemoveDocument(document_id);
+        if (write_ahead_log_) {
+            sequence_number = write_ahead_log_->Enqueue({WalRecord::Kind::REMOVE_DOCUMENT, document_id, {}, {}, {}});
+            staging.SetLogSequenceNumber(sequence_number);
+        }
+    }
+    if (write_ahead_log_) {
+        write_ahead_log_->WaitDurable(sequence_number);
+    }
+}
+
+void ConcurrentSearchServer::SetWriteAheadLog(std::shared_ptr<WriteAheadLog> write_ahead_log) {
+    write_ahead_log_ = std::move(write_ahead_log);
+}
+
+bool ConcurrentSearchServer::Publish() {
+    std::lock_guard guard(writer_mutex_);
+    if (!staging_) {
+        return false;
+    }
+    //readers must not see changes that could be lost in a crash
+    if (write_ahead_log_) {
+        write_ahead_log_->WaitDurable(staging_->GetLogSequenceNumber());
+    }
+    //the next staging copy then starts with an empty mutable segment and only shares the rest
+    staging_->FreezeMutableSegment();
+    if (!background_merging_) {
+        staging_->MergeSegments();
+    }
+    shared_ptr<const SearchServer> next_version = std::move(staging_);
+    published_.store(std::move(next_version));
+    published_version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+//====== Background segment merging: ===============
+void ConcurrentSearchServer::StartBackgroundMerging(std::chrono::milliseconds check_interval, ThreadPool& thread_pool) {
+    StopBackgroundMerging();
+    {
+        std::lock_guard guard(writer_mutex_);
+        background_merging_ = true;
+        if (staging_) {
+            staging_->SetInlineSegmentMerging(false);
+        }
+    }
+    stop_merging_ = false;
+    merge_thread_ = std::thread([this, check_interval, &thread_pool] {
+        std::unique_lock lock(merge_mutex_);
+        while (!merge_wakeup_.wait_for(lock, check_interval, [this] { return stop_merging_; })) {
+            lock.unlock();
+            MergePublishedSegments(thread_pool);
+            lock.lock();
+        }
+    });
+}
+
+void ConcurrentSearchServer::StopBackgroundMerging() {
+    if (!merge_thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(merge_mutex_);
+        stop_merging_ = true;
+    }
+    merge_wakeup_.notify_one();
+    merge_thread_.join();
+    
+    std::lock_guard guard(writer_mutex_);
+    background_merging_ = false;
+    if (staging_) {
+        staging_->SetInlineSegmentMerging(true);
+    }
+}
+
+//============== Private Methods ==============
+// writer_mutex_ must be held
+SearchServer& ConcurrentSearchServer::GetStaging() {
+    if (!staging_) {
+        //copy-on-write: the published version itself is never modified
+        staging_ = std::make_unique<SearchServer>(*published_.load());
+        staging_->SetInlineSegmentMerging(!background_merging_);
+    }
+    return *staging_;
+}
+
+// Runs on the merge thread
+void ConcurrentSearchServer::MergePublishedSegments(ThreadPool& thread_pool) {
+    for (auto plan = GetSnapshot()->PlanSegmentMerge(); !plan.segments.empty(); plan = GetSnapshot()->PlanSegmentMerge()) {
+        //the expensive part runs without locks, inputs are immutable
+        auto merged_segment = thread_pool.Wait(thread_pool.Submit([&plan] {
+            return SearchServer::ExecuteSegmentMerge(plan);
+        }));
+        
+        std::lock_guard guard(writer_mutex_);
+        auto next_version = std::make_unique<SearchServer>(*published_.load());
+        if (!next_version->ApplySegmentMerge(plan, merged_segment)) {
+            return;
+        }
+        if (staging_) {
+            staging_->ApplySegmentMerge(plan, merged_segment);
+        }
+        shared_ptr<const SearchServer> published = std::move(next_version);
+        published_.store(std::move(published));
+        published_version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+//********** End of Class Concurrent Search Server **********//
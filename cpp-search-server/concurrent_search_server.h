@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+//************* Class Concurrent Search Server *************//
+// Readers work on an immutable published version of the index and never take a lock:
+// a snapshot is a shared_ptr to a const SearchServer, loaded atomically.
+// Writers are serialized by a mutex and apply changes to a private staging copy,
+// which replaces the published version atomically on Publish().
+// Publish() freezes the mutable segment, so a staging copy shares the frozen segments and
+// the persistent document table with the published version: a copy costs O(segments + tombstones).
+// An old version is destroyed when the last reader holding its snapshot releases it.
+// Segment merges can run in the background: a thread checks for full tiers, the merged segment
+// is built on the thread pool without holding any lock, and then a version with the merged
+// segment swapped in is published.
+class ConcurrentSearchServer {
+public:
+//====== Constructors: =============================
+    explicit ConcurrentSearchServer(SearchServer initial_server);
+    ~ConcurrentSearchServer();
+
+//====== Readers (lock-free): =======================
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+    uint64_t GetPublishedVersion() const;
+    int GetDocumentCount() const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+
+//====== Writers: ===================================
+    // Changes are invisible to readers until Publish() is called
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+    // A change is applied to the staging copy first, so rejected changes are not logged.
+    // Its record is queued under the writer lock, in the order changes are applied, and waited
+    // for after the lock is released, so concurrent writers share fsyncs. Publish() also waits
+    // for every change it publishes; after a log failure nothing is published any more.
+    // Do not also set a log on the wrapped SearchServer.
+    void SetWriteAheadLog(std::shared_ptr<WriteAheadLog> write_ahead_log);
+    // Returns false if there was nothing to publish
+    bool Publish();
+
+//====== Background segment merging: ===============
+    void StartBackgroundMerging(std::chrono::milliseconds check_interval, ThreadPool& thread_pool = GetDefaultThreadPool());
+    void StopBackgroundMerging();
+
+private:
+    std::atomic<std::shared_ptr<const SearchServer>> published_;
+    std::atomic<uint64_t> published_version_;
+
+    std::mutex writer_mutex_;
+    // Copy of the published version with unpublished changes, guarded by writer_mutex_
+    std::unique_ptr<SearchServer> staging_;
+    bool background_merging_ = false;
+    //set before writers start
+    std::shared_ptr<WriteAheadLog> write_ahead_log_;
+
+    std::thread merge_thread_;
+    std::mutex merge_mutex_;
+    std::condition_variable merge_wakeup_;
+    bool stop_merging_ = false;
+
+    SearchServer& GetStaging();
+    void MergePublishedSegments(ThreadPool& thread_pool);
+};
+
+//====== Template Definitions: ========================
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
+    const auto snapshot = GetSnapshot();
+    return snapshot->FindTopDocuments(raw_query, document_predicate);
+}
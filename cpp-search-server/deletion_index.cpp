@@ -0,0 +1,165 @@
+#include "deletion_index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+using std::vector;
+using std::string;
+using std::string_view;
+
+//**************** Class Deletion Index ****************//
+DeletionIndex::DeletionIndex(int max_edit_distance)
+: max_edit_distance_(max_edit_distance) {
+}
+
+void DeletionIndex::AddWord(string_view word) {
+    const string new_word(word);
+    if (delta_.Contains(new_word) || std::any_of(chunks_.begin(), chunks_.end(), [&new_word](const auto& chunk) {
+        return chunk->Contains(new_word);
+    })) {
+        return;
+    }
+    const uint32_t word_id = static_cast<uint32_t>(delta_.words.size());
+    for (string& deletion : GenerateDeletions(word)) {
+        delta_.deletion_to_word_ids[std::move(deletion)].push_back(word_id);
+    }
+    delta_.words.push_back(new_word);
+    if (delta_.words.size() >= DELTA_WORD_LIMIT) {
+        FreezeDelta();
+    }
+}
+
+int DeletionIndex::GetMaxEditDistance() const {
+    return max_edit_distance_;
+}
+
+size_t DeletionIndex::GetWordCount() const {
+    size_t word_count = delta_.words.size();
+    for (const auto& chunk : chunks_) {
+        word_count += chunk->words.size();
+    }
+    return word_count;
+}
+
+size_t DeletionIndex::GetDeletionCount() const {
+    size_t deletion_count = delta_.deletion_to_word_ids.size();
+    for (const auto& chunk : chunks_) {
+        deletion_count += chunk->deletion_to_word_ids.size();
+    }
+    return deletion_count;
+}
+
+size_t DeletionIndex::GetChunkCount() const {
+    return chunks_.size();
+}
+
+size_t DeletionIndex::GetMemoryBytes() const {
+    size_t bytes = chunks_.capacity() * sizeof(std::shared_ptr<const Chunk>) + delta_.GetMemoryBytes();
+    for (const auto& chunk : chunks_) {
+        bytes += chunk->GetMemoryBytes();
+    }
+    return bytes;
+}
+
+//============== Private Methods ==============
+vector<string> DeletionIndex::GenerateDeletions(string_view word) const {
+    vector<string> deletions{string(word)};
+    //deletions at distance d are made from those at distance d - 1
+    size_t level_begin = 0;
+    for (int distance = 1; distance <= max_edit_distance_; ++distance) {
+        const size_t level_end = deletions.size();
+        for (size_t i = level_begin; i < level_end; ++i) {
+            for (size_t position = 0; position < deletions[i].size(); ++position) {
+                string deletion = deletions[i];
+                deletion.erase(position, 1);
+                deletions.push_back(std::move(deletion));
+            }
+        }
+        level_begin = level_end;
+    }
+    std::sort(deletions.begin(), deletions.end());
+    deletions.erase(std::unique(deletions.begin(), deletions.end()), deletions.end());
+    return deletions;
+}
+
+void DeletionIndex::FreezeDelta() {
+    Chunk frozen = std::move(delta_);
+    delta_ = Chunk();
+    std::shared_ptr<const Chunk> chunk = std::make_shared<const Chunk>(std::move(frozen));
+    //like a binary counter: each word is merged O(log words) times
+    while (!chunks_.empty() && chunks_.back()->words.size() <= chunk->words.size()) {
+        chunk = MergeChunks(*chunks_.back(), *chunk);
+        chunks_.pop_back();
+    }
+    chunks_.push_back(std::move(chunk));
+}
+
+std::shared_ptr<const DeletionIndex::Chunk> DeletionIndex::MergeChunks(const Chunk& older, Chunk newer) {
+    Chunk merged = older;
+    const uint32_t word_id_offset = static_cast<uint32_t>(merged.words.size());
+    std::move(newer.words.begin(), newer.words.end(), std::back_inserter(merged.words));
+    for (auto& [deletion, word_ids] : newer.deletion_to_word_ids) {
+        vector<uint32_t>& merged_word_ids = merged.deletion_to_word_ids[deletion];
+        for (const uint32_t word_id : word_ids) {
+            merged_word_ids.push_back(word_id + word_id_offset);
+        }
+    }
+    return std::make_shared<const Chunk>(std::move(merged));
+}
+
+//====== Chunk: ====================================
+bool DeletionIndex::Chunk::Contains(const string& word) const {
+    //a word is stored under itself, as its own deletion at distance 0
+    const auto it = deletion_to_word_ids.find(word);
+    return it != deletion_to_word_ids.end() && std::any_of(it->second.begin(), it->second.end(), [&](uint32_t word_id) {
+        return words[word_id] == word;
+    });
+}
+
+size_t DeletionIndex::Chunk::GetMemoryBytes() const {
+    //hash nodes hold the value and a next pointer, buckets are one pointer each
+    size_t bytes = words.capacity() * sizeof(string);
+    for (const string& word : words) {
+        bytes += word.size() + 1;
+    }
+    for (const auto& [deletion, word_ids] : deletion_to_word_ids) {
+        bytes += sizeof(void*) + sizeof(std::pair<const string, vector<uint32_t>>) + word_ids.capacity() * sizeof(uint32_t);
+    }
+    bytes += deletion_to_word_ids.bucket_count() * sizeof(void*);
+    return bytes;
+}
+
+//************* End of Class Deletion Index *************//
+
+int ComputeEditDistance(string_view lhs, string_view rhs, int max_distance) {
+    const int length_difference = std::abs(static_cast<int>(lhs.size()) - static_cast<int>(rhs.size()));
+    if (length_difference > max_distance) {
+        return max_distance + 1;
+    }
+    //optimal string alignment distance, three rows of the dynamic programming table
+    vector<int> previous_previous(rhs.size() + 1);
+    vector<int> previous(rhs.size() + 1);
+    vector<int> current(rhs.size() + 1);
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<int>(i);
+        int row_min = current[0];
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                current[j] = std::min(current[j], previous_previous[j - 2] + 1);
+            }
+            row_min = std::min(row_min, current[j]);
+        }
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+        std::swap(previous_previous, previous);
+        std::swap(previous, current);
+    }
+    return std::min(previous[rhs.size()], max_distance + 1);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct WordCorrection {
+    std::string word;
+    int edit_distance = 0;
+};
+
+//**************** Class Deletion Index ****************//
+// Symmetric deletion index for spelling correction (as in SymSpell): every word is stored
+// under all strings obtained by deleting up to max_edit_distance characters from it.
+// A query word and a dictionary word within the edit distance share at least one such
+// string, so candidates are found by hashing the deletions of the query word,
+// without comparing it to the whole vocabulary. Candidates are then checked with
+// the exact (Damerau-Levenshtein, adjacent transpositions) distance.
+// New words go to a small mutable delta, which is frozen into an immutable chunk when full;
+// a chunk is merged with the previous one while that one is not larger, so there are
+// O(log words) chunks. Copies share the chunks and only copy the delta.
+class DeletionIndex {
+public:
+    static inline constexpr size_t DELTA_WORD_LIMIT = 256;
+
+    explicit DeletionIndex(int max_edit_distance);
+
+    //does nothing if the word is already indexed
+    void AddWord(std::string_view word);
+    // Words at the smallest edit distance (0 if the word itself is indexed) among the words
+    // accepted by is_accepted(std::string_view word), sorted. Words the predicate rejects,
+    // e.g. words only found in removed documents, do not hide farther ones.
+    template <typename WordPredicate>
+    std::vector<WordCorrection> FindClosestWords(std::string_view word, WordPredicate is_accepted) const;
+    int GetMaxEditDistance() const;
+    size_t GetWordCount() const;
+    //summed over chunks, a deletion shared by words of several chunks is counted in each
+    size_t GetDeletionCount() const;
+    size_t GetChunkCount() const;
+    //chunks shared with copies are counted in full
+    size_t GetMemoryBytes() const;
+
+private:
+    struct Chunk {
+        std::vector<std::string> words;
+        std::unordered_map<std::string, std::vector<uint32_t>> deletion_to_word_ids;
+
+        bool Contains(const std::string& word) const;
+        size_t GetMemoryBytes() const;
+    };
+
+    int max_edit_distance_ = 0;
+    std::vector<std::shared_ptr<const Chunk>> chunks_;  //in order of size, largest first
+    Chunk delta_;
+
+    //the word itself and all its deletions, without duplicates
+    std::vector<std::string> GenerateDeletions(std::string_view word) const;
+    void FreezeDelta();
+    static std::shared_ptr<const Chunk> MergeChunks(const Chunk& older, Chunk newer);
+};
+
+//returns max_distance + 1 if the distance is greater than max_distance
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance);
+
+//====== Template Definitions: ========================
+template <typename WordPredicate>
+std::vector<WordCorrection> DeletionIndex::FindClosestWords(std::string_view word, WordPredicate is_accepted) const {
+    std::vector<WordCorrection> corrections;
+    int best_distance = max_edit_distance_;
+    const std::vector<std::string> deletions = GenerateDeletions(word);
+    auto search_chunk = [&](const Chunk& chunk) {
+        std::unordered_set<uint32_t> checked_word_ids;
+        for (const std::string& deletion : deletions) {
+            const auto it = chunk.deletion_to_word_ids.find(deletion);
+            if (it == chunk.deletion_to_word_ids.end()) {
+                continue;
+            }
+            for (const uint32_t word_id : it->second) {
+                if (!checked_word_ids.insert(word_id).second) {
+                    continue;
+                }
+                const std::string& candidate = chunk.words[word_id];
+                //the predicate may be expensive, it is only asked about words close enough
+                const int distance = ComputeEditDistance(word, candidate, best_distance);
+                if (distance > best_distance || !is_accepted(std::string_view(candidate))) {
+                    continue;
+                }
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    corrections.clear();
+                }
+                corrections.push_back({candidate, distance});
+            }
+        }
+    };
+    for (const auto& chunk : chunks_) {
+        search_chunk(*chunk);
+    }
+    search_chunk(delta_);
+    std::sort(corrections.begin(), corrections.end(), [](const WordCorrection& lhs, const WordCorrection& rhs) {
+        return lhs.word < rhs.word;
+    });
+    return corrections;
+}
@@ -18,6 +18,14 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+//input of SearchServer::AddDocuments
+struct NewDocument {
+    int id = 0;
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 void PrintDocument(const Document& document);
 
 std::ostream& operator<<(std::ostream& out, const Document& document);
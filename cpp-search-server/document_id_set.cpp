@@ -0,0 +1,36 @@
+#include "document_id_set.h"
+
+using std::vector;
+
+//**************** Class Document Id Set ****************//
+DocumentIdSet::DocumentIdSet(vector<int> document_ids) {
+    std::sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(std::unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    size_ = document_ids.size();
+    if (document_ids.empty()) {
+        return;
+    }
+    const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(document_ids.back()) - document_ids.front()) + 1;
+    if (range > document_ids.size() * BITMAP_BITS_PER_ID) {
+        sorted_ids_ = std::move(document_ids);
+        return;
+    }
+    first_id_ = document_ids.front();
+    bitmap_.assign((range + 63) / 64, 0);
+    for (const int document_id : document_ids) {
+        const uint64_t offset = static_cast<uint64_t>(document_id - first_id_);
+        bitmap_[offset / 64] |= uint64_t{1} << (offset % 64);
+    }
+}
+
+bool DocumentIdSet::Empty() const {
+    return size_ == 0;
+}
+
+size_t DocumentIdSet::GetSize() const {
+    return size_;
+}
+
+bool DocumentIdSet::IsBitmap() const {
+    return !bitmap_.empty();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//**************** Class Document Id Set ****************//
+// Immutable set of document ids built for fast membership tests.
+// Dense ids are stored as a bitmap over [min id, max id]; if the bitmap would take more
+// than BITMAP_BITS_PER_ID bits per stored id, sorted ids are binary searched instead.
+class DocumentIdSet {
+public:
+    static inline constexpr size_t BITMAP_BITS_PER_ID = 64;
+
+    DocumentIdSet() = default;
+    //ids in any order, duplicates allowed
+    explicit DocumentIdSet(std::vector<int> document_ids);
+
+    bool Contains(int document_id) const;
+    bool Empty() const;
+    size_t GetSize() const;
+    bool IsBitmap() const;
+
+private:
+    size_t size_ = 0;
+    int first_id_ = 0;
+    std::vector<uint64_t> bitmap_; //bit i is id first_id_ + i
+    std::vector<int> sorted_ids_;  //used if the bitmap is empty
+};
+
+//====== Inline Definitions: ==========================
+inline bool DocumentIdSet::Contains(int document_id) const {
+    if (!bitmap_.empty()) {
+        const uint64_t offset = static_cast<uint64_t>(static_cast<int64_t>(document_id) - first_id_);
+        return offset < bitmap_.size() * 64 && ((bitmap_[offset / 64] >> (offset % 64)) & 1) != 0;
+    }
+    return std::binary_search(sorted_ids_.begin(), sorted_ids_.end(), document_id);
+}
@@ -0,0 +1,455 @@
+#include "index_segment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+using std::vector;
+using std::string_view;
+using std::shared_ptr;
+using std::set;
+
+namespace {
+
+size_t GetTermFreqBytes(TermFreqPrecision precision) {
+    switch (precision) {
+        case TermFreqPrecision::DOUBLE:
+            return sizeof(double);
+        case TermFreqPrecision::FLOAT:
+            return sizeof(float);
+        case TermFreqPrecision::IMPACT_16:
+            return sizeof(uint16_t);
+        case TermFreqPrecision::IMPACT_8:
+            return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+size_t AlignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+//====== Posting List ================================
+bool PostingList::Empty() const {
+    return size == 0;
+}
+
+bool PostingList::Contains(int document_id) const {
+    return std::binary_search(document_ids, document_ids + size, document_id);
+}
+
+size_t PostingList::Find(int document_id) const {
+    const int* it = std::lower_bound(document_ids, document_ids + size, document_id);
+    return it != document_ids + size && *it == document_id ? it - document_ids : size;
+}
+
+bool PostingList::HasPositions() const {
+    return position_offsets != nullptr;
+}
+
+string_view PostingList::GetPositions(size_t index) const {
+    return string_view(position_data + position_offsets[index], position_offsets[index + 1] - position_offsets[index]);
+}
+
+//**************** Class Index Segment ****************//
+//====== Construction: ==============================
+shared_ptr<const IndexSegment> IndexSegment::Build(const WordToDocumentFreqs& word_to_document_freqs,
+                                                   const set<int>& removed_document_ids,
+                                                   TermFreqPrecision precision,
+                                                   const WordToDocumentPositions* word_to_document_positions) {
+    auto segment = std::make_shared<IndexSegment>();
+    segment->precision_ = precision;
+    segment->has_positions_ = word_to_document_positions != nullptr;
+    if (segment->has_positions_) {
+        segment->position_offsets_.push_back(0);
+    }
+    vector<BuildPosting> postings;
+    for (const auto& [word, document_freqs] : word_to_document_freqs) {
+        postings.clear();
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            postings.push_back({document_id, term_freq, {}});
+        }
+        if (segment->has_positions_) {
+            //both maps are sorted by document id
+            const auto& document_positions = word_to_document_positions->at(word);
+            auto posting = postings.begin();
+            for (const auto& [document_id, positions] : document_positions) {
+                (posting++)->positions = positions;
+            }
+        }
+        segment->AppendWord(word, postings, removed_document_ids);
+    }
+    segment->FinishBuild();
+    return segment;
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Merge(const vector<shared_ptr<const IndexSegment>>& segments,
+                                                   const set<int>& removed_document_ids,
+                                                   TermFreqPrecision precision) {
+    auto merged = std::make_shared<IndexSegment>();
+    merged->precision_ = precision;
+    merged->has_positions_ = std::all_of(segments.begin(), segments.end(), [](const auto& segment) {
+        return segment->HasPositions();
+    });
+    if (merged->has_positions_) {
+        merged->position_offsets_.push_back(0);
+    }
+    //k-way merge over the sorted word lists, k is small (size of one merge tier)
+    vector<size_t> cursors(segments.size(), 0);
+    vector<BuildPosting> postings;
+    vector<uint32_t> access_counts;
+    while (true) {
+        std::optional<string_view> min_word;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            if (cursors[i] < segments[i]->GetWordCount()) {
+                const string_view word = segments[i]->GetWord(cursors[i]);
+                if (!min_word || word < *min_word) {
+                    min_word = word;
+                }
+            }
+        }
+        if (!min_word) {
+            break;
+        }
+        postings.clear();
+        uint32_t access_count = 0;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            if (cursors[i] < segments[i]->GetWordCount() && segments[i]->GetWord(cursors[i]) == *min_word) {
+                access_count += segments[i]->GetAccessCount(cursors[i]);
+                const PostingList word_postings = segments[i]->GetPostings(cursors[i]);
+                for (size_t j = 0; j < word_postings.size; ++j) {
+                    postings.push_back({word_postings.document_ids[j], word_postings.GetTermFreq<double>(j),
+                                        merged->has_positions_ ? word_postings.GetPositions(j) : string_view{}});
+                }
+                ++cursors[i];
+            }
+        }
+        //each document belongs to exactly one segment, so ids never repeat
+        std::sort(postings.begin(), postings.end(), [](const BuildPosting& lhs, const BuildPosting& rhs) {
+            return lhs.document_id < rhs.document_id;
+        });
+        if (merged->AppendWord(*min_word, postings, removed_document_ids)) {
+            access_counts.push_back(access_count);
+        }
+    }
+    merged->FinishBuild();
+    for (size_t word_index = 0; word_index < access_counts.size(); ++word_index) {
+        merged->access_counts_[word_index].store(access_counts[word_index], std::memory_order_relaxed);
+    }
+    return merged;
+}
+
+shared_ptr<const IndexSegment> IndexSegment::Retier(const IndexSegment& segment, const vector<bool>& is_hot,
+                                                    const std::string& cold_file_path) {
+    auto retiered = std::make_shared<IndexSegment>();
+    retiered->precision_ = segment.precision_;
+    retiered->words_data_ = segment.words_data_;
+    retiered->word_offsets_ = segment.word_offsets_;
+    retiered->posting_offsets_ = segment.posting_offsets_;
+    retiered->document_ids_ = segment.document_ids_;
+    retiered->has_positions_ = segment.has_positions_;
+    if (retiered->has_positions_) {
+        retiered->position_offsets_.push_back(0);
+    }
+    const bool has_cold_words = std::find(is_hot.begin(), is_hot.end(), false) != is_hot.end();
+    std::optional<MappedFileWriter> cold_writer;
+    if (has_cold_words) {
+        cold_writer.emplace(cold_file_path);
+        retiered->word_storage_.resize(segment.GetWordCount());
+    }
+    const size_t term_freq_bytes = GetTermFreqBytes(retiered->precision_);
+    for (size_t word_index = 0; word_index < segment.GetWordCount(); ++word_index) {
+        const PostingList postings = segment.GetPostings(word_index);
+        const auto* term_freqs = static_cast<const char*>(postings.term_freqs);
+        uint32_t position_bytes = 0;
+        if (retiered->has_positions_) {
+            position_bytes = postings.position_offsets[postings.size] - postings.position_offsets[0];
+        }
+        if (is_hot[word_index]) {
+            if (has_cold_words) {
+                retiered->word_storage_[word_index] = {retiered->posting_document_ids_.size(), position_bytes, false};
+            }
+            retiered->posting_document_ids_.insert(retiered->posting_document_ids_.end(),
+                                                   postings.document_ids, postings.document_ids + postings.size);
+            //term frequencies are copied as stored, without converting the precision twice
+            switch (retiered->precision_) {
+                case TermFreqPrecision::DOUBLE:
+                    retiered->posting_term_freqs_.insert(retiered->posting_term_freqs_.end(),
+                        reinterpret_cast<const double*>(term_freqs), reinterpret_cast<const double*>(term_freqs) + postings.size);
+                    break;
+                case TermFreqPrecision::FLOAT:
+                    retiered->posting_term_freqs_float_.insert(retiered->posting_term_freqs_float_.end(),
+                        reinterpret_cast<const float*>(term_freqs), reinterpret_cast<const float*>(term_freqs) + postings.size);
+                    break;
+                case TermFreqPrecision::IMPACT_16:
+                    retiered->posting_impacts_16_.insert(retiered->posting_impacts_16_.end(),
+                        reinterpret_cast<const uint16_t*>(term_freqs), reinterpret_cast<const uint16_t*>(term_freqs) + postings.size);
+                    break;
+                case TermFreqPrecision::IMPACT_8:
+                    retiered->posting_impacts_8_.insert(retiered->posting_impacts_8_.end(),
+                        reinterpret_cast<const uint8_t*>(term_freqs), reinterpret_cast<const uint8_t*>(term_freqs) + postings.size);
+                    break;
+            }
+            if (retiered->has_positions_) {
+                for (size_t i = 0; i < postings.size; ++i) {
+                    retiered->position_data_.append(postings.GetPositions(i));
+                    retiered->position_offsets_.push_back(static_cast<uint32_t>(retiered->position_data_.size()));
+                }
+            }
+            continue;
+        }
+        cold_writer->AlignTo(sizeof(uint64_t));
+        retiered->word_storage_[word_index] = {cold_writer->GetSize(), position_bytes, true};
+        retiered->cold_posting_count_ += postings.size;
+        cold_writer->Append(postings.document_ids, postings.size * sizeof(int));
+        cold_writer->AlignTo(sizeof(uint64_t));
+        cold_writer->Append(term_freqs, postings.size * term_freq_bytes);
+        if (retiered->has_positions_) {
+            cold_writer->AlignTo(sizeof(uint32_t));
+            //offsets are relative to the word's position data
+            for (size_t i = 0; i <= postings.size; ++i) {
+                const uint32_t offset = postings.position_offsets[i] - postings.position_offsets[0];
+                cold_writer->Append(&offset, sizeof(offset));
+            }
+            cold_writer->Append(postings.position_data + postings.position_offsets[0], position_bytes);
+        }
+    }
+    if (cold_writer) {
+        retiered->cold_file_ = cold_writer->Finish();
+    }
+    retiered->FinishBuild();
+    for (size_t word_index = 0; word_index < segment.GetWordCount(); ++word_index) {
+        retiered->access_counts_[word_index].store(segment.GetAccessCount(word_index), std::memory_order_relaxed);
+    }
+    return retiered;
+}
+
+//====== Lookup: ====================================
+PostingList IndexSegment::FindPostings(string_view word) const {
+    const size_t word_index = LowerBound(word);
+    if (word_index < GetWordCount() && GetWord(word_index) == word) {
+        access_counts_[word_index].fetch_add(1, std::memory_order_relaxed);
+        if (IsCold(word_index)) {
+            cold_file_->AdviseWillNeed(word_storage_[word_index].offset, GetColdBlockBytes(word_index));
+        }
+        return GetPostings(word_index);
+    }
+    return {};
+}
+
+size_t IndexSegment::LowerBound(string_view word) const {
+    size_t left = 0;
+    size_t right = GetWordCount();
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (GetWord(middle) < word) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left;
+}
+
+bool IndexSegment::ContainsDocument(int document_id) const {
+    return std::binary_search(document_ids_.begin(), document_ids_.end(), document_id);
+}
+
+//====== Get functions: =============================
+size_t IndexSegment::GetDocumentCount() const {
+    return document_ids_.size();
+}
+
+size_t IndexSegment::GetWordCount() const {
+    return word_offsets_.size() - 1;
+}
+
+size_t IndexSegment::GetPostingCount() const {
+    return posting_offsets_.back();
+}
+
+string_view IndexSegment::GetWord(size_t word_index) const {
+    return string_view(words_data_).substr(word_offsets_[word_index],
+                                           word_offsets_[word_index + 1] - word_offsets_[word_index]);
+}
+
+PostingList IndexSegment::GetPostings(size_t word_index) const {
+    if (IsCold(word_index)) {
+        return GetColdPostings(word_index);
+    }
+    const size_t begin = word_storage_.empty() ? posting_offsets_[word_index] : word_storage_[word_index].offset;
+    PostingList postings;
+    postings.document_ids = posting_document_ids_.data() + begin;
+    postings.precision = precision_;
+    postings.size = posting_offsets_[word_index + 1] - posting_offsets_[word_index];
+    switch (precision_) {
+        case TermFreqPrecision::DOUBLE:
+            postings.term_freqs = posting_term_freqs_.data() + begin;
+            break;
+        case TermFreqPrecision::FLOAT:
+            postings.term_freqs = posting_term_freqs_float_.data() + begin;
+            break;
+        case TermFreqPrecision::IMPACT_16:
+            postings.term_freqs = posting_impacts_16_.data() + begin;
+            break;
+        case TermFreqPrecision::IMPACT_8:
+            postings.term_freqs = posting_impacts_8_.data() + begin;
+            break;
+    }
+    if (has_positions_) {
+        postings.position_data = position_data_.data();
+        postings.position_offsets = position_offsets_.data() + begin;
+    }
+    return postings;
+}
+
+TermFreqPrecision IndexSegment::GetTermFreqPrecision() const {
+    return precision_;
+}
+
+bool IndexSegment::HasPositions() const {
+    return has_positions_;
+}
+
+size_t IndexSegment::GetMemoryBytes() const {
+    return sizeof(IndexSegment)
+        + words_data_.capacity()
+        + word_offsets_.capacity() * sizeof(uint32_t)
+        + posting_offsets_.capacity() * sizeof(uint32_t)
+        + posting_document_ids_.capacity() * sizeof(int)
+        + posting_term_freqs_.capacity() * sizeof(double)
+        + posting_term_freqs_float_.capacity() * sizeof(float)
+        + posting_impacts_16_.capacity() * sizeof(uint16_t)
+        + posting_impacts_8_.capacity() * sizeof(uint8_t)
+        + document_ids_.capacity() * sizeof(int)
+        + position_data_.capacity()
+        + position_offsets_.capacity() * sizeof(uint32_t)
+        + word_storage_.capacity() * sizeof(WordStorage)
+        + access_counts_.size() * sizeof(std::atomic<uint32_t>);
+}
+
+//====== Tiered storage: ============================
+bool IndexSegment::IsCold(size_t word_index) const {
+    return !word_storage_.empty() && word_storage_[word_index].is_cold;
+}
+
+size_t IndexSegment::GetPostingBytes(size_t word_index) const {
+    const size_t size = posting_offsets_[word_index + 1] - posting_offsets_[word_index];
+    size_t position_bytes = 0;
+    if (!word_storage_.empty()) {
+        position_bytes = word_storage_[word_index].position_bytes;
+    } else if (has_positions_) {
+        position_bytes = position_offsets_[posting_offsets_[word_index + 1]] - position_offsets_[posting_offsets_[word_index]];
+    }
+    return size * (sizeof(int) + GetTermFreqBytes(precision_)) + position_bytes;
+}
+
+size_t IndexSegment::GetHotPostingBytes() const {
+    return posting_document_ids_.size() * (sizeof(int) + GetTermFreqBytes(precision_)) + position_data_.size();
+}
+
+size_t IndexSegment::GetColdPostingCount() const {
+    return cold_posting_count_;
+}
+
+size_t IndexSegment::GetColdFileBytes() const {
+    return cold_file_ ? cold_file_->GetSize() : 0;
+}
+
+uint32_t IndexSegment::GetAccessCount(size_t word_index) const {
+    return access_counts_[word_index].load(std::memory_order_relaxed);
+}
+
+void IndexSegment::DecayAccessCounts() const {
+    for (auto& access_count : access_counts_) {
+        access_count.store(access_count.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+}
+
+//============== Private Methods ==============
+bool IndexSegment::AppendWord(string_view word, const vector<BuildPosting>& postings,
+                              const set<int>& removed_document_ids) {
+    const size_t postings_before = posting_document_ids_.size();
+    for (const auto& [document_id, term_freq, positions] : postings) {
+        if (removed_document_ids.count(document_id) == 0) {
+            posting_document_ids_.push_back(document_id);
+            AppendTermFreq(term_freq);
+            document_ids_.push_back(document_id);
+            if (has_positions_) {
+                position_data_.append(positions);
+                position_offsets_.push_back(static_cast<uint32_t>(position_data_.size()));
+            }
+        }
+    }
+    if (posting_document_ids_.size() == postings_before) {
+        return false; //all postings removed, drop the word
+    }
+    words_data_.append(word);
+    word_offsets_.push_back(static_cast<uint32_t>(words_data_.size()));
+    posting_offsets_.push_back(static_cast<uint32_t>(posting_document_ids_.size()));
+    return true;
+}
+
+void IndexSegment::AppendTermFreq(double term_freq) {
+    switch (precision_) {
+        case TermFreqPrecision::DOUBLE:
+            posting_term_freqs_.push_back(term_freq);
+            break;
+        case TermFreqPrecision::FLOAT:
+            posting_term_freqs_float_.push_back(static_cast<float>(term_freq));
+            break;
+        case TermFreqPrecision::IMPACT_16:
+            //never round a present word down to zero
+            posting_impacts_16_.push_back(static_cast<uint16_t>(std::clamp(std::lround(std::sqrt(term_freq) * UINT16_MAX), 1l, static_cast<long>(UINT16_MAX))));
+            break;
+        case TermFreqPrecision::IMPACT_8:
+            posting_impacts_8_.push_back(static_cast<uint8_t>(std::clamp(std::lround(std::sqrt(term_freq) * UINT8_MAX), 1l, static_cast<long>(UINT8_MAX))));
+            break;
+    }
+}
+
+void IndexSegment::FinishBuild() {
+    std::sort(document_ids_.begin(), document_ids_.end());
+    document_ids_.erase(std::unique(document_ids_.begin(), document_ids_.end()), document_ids_.end());
+    document_ids_.shrink_to_fit();
+    words_data_.shrink_to_fit();
+    word_offsets_.shrink_to_fit();
+    posting_offsets_.shrink_to_fit();
+    posting_document_ids_.shrink_to_fit();
+    posting_term_freqs_.shrink_to_fit();
+    posting_term_freqs_float_.shrink_to_fit();
+    posting_impacts_16_.shrink_to_fit();
+    posting_impacts_8_.shrink_to_fit();
+    position_data_.shrink_to_fit();
+    position_offsets_.shrink_to_fit();
+    access_counts_ = vector<std::atomic<uint32_t>>(GetWordCount());
+}
+
+PostingList IndexSegment::GetColdPostings(size_t word_index) const {
+    const char* block = cold_file_->GetData() + word_storage_[word_index].offset;
+    PostingList postings;
+    postings.precision = precision_;
+    postings.size = posting_offsets_[word_index + 1] - posting_offsets_[word_index];
+    postings.document_ids = reinterpret_cast<const int*>(block);
+    size_t offset = AlignUp(postings.size * sizeof(int), sizeof(uint64_t));
+    postings.term_freqs = block + offset;
+    if (has_positions_) {
+        offset = AlignUp(offset + postings.size * GetTermFreqBytes(precision_), sizeof(uint32_t));
+        postings.position_offsets = reinterpret_cast<const uint32_t*>(block + offset);
+        postings.position_data = block + offset + (postings.size + 1) * sizeof(uint32_t);
+    }
+    return postings;
+}
+
+size_t IndexSegment::GetColdBlockBytes(size_t word_index) const {
+    const size_t size = posting_offsets_[word_index + 1] - posting_offsets_[word_index];
+    size_t bytes = AlignUp(size * sizeof(int), sizeof(uint64_t)) + size * GetTermFreqBytes(precision_);
+    if (has_positions_) {
+        bytes = AlignUp(bytes, sizeof(uint32_t)) + (size + 1) * sizeof(uint32_t) + word_storage_[word_index].position_bytes;
+    }
+    return bytes;
+}
+
+//************* End of Class Index Segment *************//
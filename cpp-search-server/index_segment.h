@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+
+//How term frequencies are stored in frozen segments.
+//IMPACT_* modes store sqrt(tf) linearly quantized to 16 or 8 bits: tf is in (0, 1] and
+//the square root keeps the relative error small for long documents with small tf.
+enum class TermFreqPrecision {
+    DOUBLE,
+    FLOAT,
+    IMPACT_16,
+    IMPACT_8,
+};
+
+//Postings of a single word inside a segment, sorted by document id
+struct PostingList {
+    const int* document_ids = nullptr;
+    const void* term_freqs = nullptr;
+    TermFreqPrecision precision = TermFreqPrecision::DOUBLE;
+    size_t size = 0;
+    //empty if the segment has no positional index
+    const char* position_data = nullptr;
+    const uint32_t* position_offsets = nullptr; //positions of posting i are [offsets[i], offsets[i + 1])
+
+    bool Empty() const;
+    bool Contains(int document_id) const;
+    //index of the document's posting, or size if the word is not in the document
+    size_t Find(int document_id) const;
+    bool HasPositions() const;
+    //encoded as by EncodePositions
+    std::string_view GetPositions(size_t index) const;
+    template <typename Score>
+    Score GetTermFreq(size_t index) const;
+};
+
+//**************** Class Index Segment ****************//
+// Immutable, compactly stored part of the inverted index:
+// all words are kept in one sorted buffer and all postings in flat arrays.
+// Segments are only created by Build (freezing the mutable segment), Merge or Retier,
+// so they can be shared between SearchServer copies and read without locks.
+// Postings can be split into two tiers: hot words keep their postings in memory, postings of
+// cold words are stored in a memory-mapped file, one block per word, read in on first access.
+// Lookups by word are counted to choose the hot words; counters are shared by the SearchServer
+// copies using the segment and are approximate under concurrent lookups.
+class IndexSegment {
+public:
+    using WordToDocumentFreqs = std::map<std::string, std::map<int, double>>;
+    //encoded positions, same keys as WordToDocumentFreqs
+    using WordToDocumentPositions = std::map<std::string, std::map<int, std::string>>;
+//====== Construction: ==============================
+    //postings of removed documents are dropped
+    static std::shared_ptr<const IndexSegment> Build(const WordToDocumentFreqs& word_to_document_freqs,
+                                                     const std::set<int>& removed_document_ids,
+                                                     TermFreqPrecision precision = TermFreqPrecision::DOUBLE,
+                                                     const WordToDocumentPositions* word_to_document_positions = nullptr);
+    //the merged segment has positions if all merged segments have them
+    static std::shared_ptr<const IndexSegment> Merge(const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+                                                     const std::set<int>& removed_document_ids,
+                                                     TermFreqPrecision precision = TermFreqPrecision::DOUBLE);
+    //same words and postings, words with is_hot[word_index] == false are written to a new cold file
+    static std::shared_ptr<const IndexSegment> Retier(const IndexSegment& segment, const std::vector<bool>& is_hot,
+                                                      const std::string& cold_file_path);
+//====== Lookup: ====================================
+    //counts the lookup of a found word
+    PostingList FindPostings(std::string_view word) const;
+    //index of the first word not less than the given one
+    size_t LowerBound(std::string_view word) const;
+    bool ContainsDocument(int document_id) const;
+//====== Get functions: =============================
+    size_t GetDocumentCount() const;
+    size_t GetWordCount() const;
+    size_t GetPostingCount() const;
+    std::string_view GetWord(size_t word_index) const;
+    PostingList GetPostings(size_t word_index) const;
+    TermFreqPrecision GetTermFreqPrecision() const;
+    bool HasPositions() const;
+    //resident bytes, the cold file is not included
+    size_t GetMemoryBytes() const;
+//====== Tiered storage: ============================
+    bool IsCold(size_t word_index) const;
+    //document ids, term frequencies & positions of the word
+    size_t GetPostingBytes(size_t word_index) const;
+    //bytes of the postings kept in memory, as summed by GetPostingBytes
+    size_t GetHotPostingBytes() const;
+    size_t GetColdPostingCount() const;
+    size_t GetColdFileBytes() const;
+    uint32_t GetAccessCount(size_t word_index) const;
+    //halves all counters, so words that are no longer looked up lose their rank
+    void DecayAccessCounts() const;
+
+private:
+    TermFreqPrecision precision_ = TermFreqPrecision::DOUBLE;
+    std::string words_data_;
+    std::vector<uint32_t> word_offsets_{0};    //word i is words_data_[word_offsets_[i], word_offsets_[i + 1])
+    std::vector<uint32_t> posting_offsets_{0}; //same layout for the posting arrays
+    std::vector<int> posting_document_ids_;
+    //only the vector matching precision_ is filled
+    std::vector<double> posting_term_freqs_;
+    std::vector<float> posting_term_freqs_float_;
+    std::vector<uint16_t> posting_impacts_16_;
+    std::vector<uint8_t> posting_impacts_8_;
+    std::vector<int> document_ids_;            //sorted ids of all documents with postings here
+    bool has_positions_ = false;
+    std::string position_data_;
+    std::vector<uint32_t> position_offsets_;   //one per posting and the end, if has_positions_
+    //Tiered storage: if the segment has a cold file, the arrays above hold only hot postings
+    struct WordStorage {
+        uint64_t offset = 0;         //first posting in the hot arrays, or block offset in the cold file
+        uint32_t position_bytes = 0;
+        bool is_cold = false;
+    };
+    std::vector<WordStorage> word_storage_;    //one per word if there is a cold file
+    std::shared_ptr<const MappedFile> cold_file_;
+    size_t cold_posting_count_ = 0;
+    mutable std::vector<std::atomic<uint32_t>> access_counts_;
+
+    struct BuildPosting {
+        int document_id = 0;
+        double term_freq = 0.0;
+        std::string_view positions;
+    };
+    //postings must be sorted by document id; returns false if all postings were removed
+    bool AppendWord(std::string_view word, const std::vector<BuildPosting>& postings,
+                    const std::set<int>& removed_document_ids);
+    void AppendTermFreq(double term_freq);
+    void FinishBuild();
+    //cold block of a word: document ids, term frequencies, position offsets and data, each aligned
+    PostingList GetColdPostings(size_t word_index) const;
+    size_t GetColdBlockBytes(size_t word_index) const;
+};
+
+//====== Template Definitions: ========================
+template <typename Score>
+Score PostingList::GetTermFreq(size_t index) const {
+    switch (precision) {
+        case TermFreqPrecision::DOUBLE:
+            return static_cast<Score>(static_cast<const double*>(term_freqs)[index]);
+        case TermFreqPrecision::FLOAT:
+            return static_cast<Score>(static_cast<const float*>(term_freqs)[index]);
+        case TermFreqPrecision::IMPACT_16: {
+            const Score root = static_cast<const uint16_t*>(term_freqs)[index] * (Score(1) / UINT16_MAX);
+            return root * root;
+        }
+        case TermFreqPrecision::IMPACT_8: {
+            const Score root = static_cast<const uint8_t*>(term_freqs)[index] * (Score(1) / UINT8_MAX);
+            return root * root;
+        }
+    }
+    return Score(0);
+}
@@ -1,9 +1,13 @@
 #include <iostream>
+#include <string_view>
+#include <vector>
 
+#include "benchmarks.h"
 #include "document.h"
 #include "search_server.h"
 #include "request_queue.h"
 #include "paginator.h"
+#include "query_replay.h"
 #include "unit_test_framework.h"
 
 using std::cerr;
@@ -16,7 +20,14 @@ auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark") {
+        RunBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--replay") {
+        return RunReplayTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
     TestSearchServer();
     cerr << "Search server testing finished"s << endl;
     //OptionalUseExample();
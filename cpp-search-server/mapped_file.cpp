@@ -0,0 +1,108 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+
+//**************** Class Mapped File ****************//
+MappedFile::MappedFile(const string& path) {
+    const int file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error(MAPPED_FILE_OPEN_ERROR_MSG);
+    }
+    struct stat file_stat{};
+    void* data = MAP_FAILED;
+    if (fstat(file_descriptor, &file_stat) == 0 && file_stat.st_size > 0) {
+        size_ = static_cast<size_t>(file_stat.st_size);
+        data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    }
+    //the mapping keeps the file alive
+    close(file_descriptor);
+    unlink(path.c_str());
+    if (data == MAP_FAILED) {
+        throw std::runtime_error(MAPPED_FILE_OPEN_ERROR_MSG);
+    }
+    data_ = static_cast<const char*>(data);
+    //postings are looked up by word, readahead would mostly read other words
+    madvise(data, size_, MADV_RANDOM);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+const char* MappedFile::GetData() const {
+    return data_;
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+void MappedFile::AdviseWillNeed(size_t offset, size_t length) const {
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t page_offset = offset / page_size * page_size;
+    madvise(const_cast<char*>(data_) + page_offset, offset + length - page_offset, MADV_WILLNEED);
+}
+
+//************* Class Mapped File Writer *************//
+MappedFileWriter::MappedFileWriter(const string& path)
+: path_(path)
+, file_descriptor_(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600)) {
+    if (file_descriptor_ < 0) {
+        throw std::runtime_error(MAPPED_FILE_OPEN_ERROR_MSG);
+    }
+    buffer_.reserve(BUFFER_SIZE);
+}
+
+MappedFileWriter::~MappedFileWriter() {
+    //not finished: an exception was thrown, the partial file is removed
+    if (file_descriptor_ >= 0) {
+        close(file_descriptor_);
+        unlink(path_.c_str());
+    }
+}
+
+void MappedFileWriter::Append(const void* data, size_t size) {
+    buffer_.append(static_cast<const char*>(data), size);
+    size_ += size;
+    if (buffer_.size() >= BUFFER_SIZE) {
+        Flush();
+    }
+}
+
+void MappedFileWriter::AlignTo(size_t alignment) {
+    const size_t padding = (alignment - size_ % alignment) % alignment;
+    buffer_.append(padding, '\0');
+    size_ += padding;
+}
+
+size_t MappedFileWriter::GetSize() const {
+    return size_;
+}
+
+std::shared_ptr<const MappedFile> MappedFileWriter::Finish() {
+    Flush();
+    close(file_descriptor_);
+    file_descriptor_ = -1;
+    return std::make_shared<const MappedFile>(path_);
+}
+
+//============== Private Methods ==============
+void MappedFileWriter::Flush() {
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        const ssize_t result = write(file_descriptor_, buffer_.data() + written, buffer_.size() - written);
+        if (result < 0) {
+            throw std::runtime_error(MAPPED_FILE_WRITE_ERROR_MSG);
+        }
+        written += static_cast<size_t>(result);
+    }
+    buffer_.clear();
+}
+
+//********** End of Class Mapped File Writer **********//
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+//===== Mapped File Error Messages ===================
+const std::string MAPPED_FILE_OPEN_ERROR_MSG = "MappedFile ERROR: Cannot create or map file";
+const std::string MAPPED_FILE_WRITE_ERROR_MSG = "MappedFile ERROR: Cannot write file";
+
+//**************** Class Mapped File ****************//
+// Read-only memory mapping of a whole file. The file is unlinked right after it is mapped:
+// its pages stay reachable through the mapping and the disk space is freed with it.
+// Pages are read from disk on first access, so the data does not count as resident
+// until it is touched; madvise hints steer readahead and eviction.
+class MappedFile {
+public:
+    //the file must not be empty
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const;
+    size_t GetSize() const;
+    //asks the kernel to read the range ahead, offsets need not be page-aligned
+    void AdviseWillNeed(size_t offset, size_t length) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+//************* Class Mapped File Writer *************//
+// Buffered sequential writer of a new file, which is mapped once written.
+class MappedFileWriter {
+public:
+    //creates or truncates the file
+    explicit MappedFileWriter(const std::string& path);
+    ~MappedFileWriter();
+    MappedFileWriter(const MappedFileWriter&) = delete;
+    MappedFileWriter& operator=(const MappedFileWriter&) = delete;
+
+    void Append(const void* data, size_t size);
+    //pads with zeros up to a multiple of alignment
+    void AlignTo(size_t alignment);
+    size_t GetSize() const;
+    //writes the rest of the buffer, closes and maps the file
+    std::shared_ptr<const MappedFile> Finish();
+
+private:
+    static inline constexpr size_t BUFFER_SIZE = 1 << 20;
+    std::string path_;
+    int file_descriptor_ = -1;
+    std::string buffer_;
+    size_t size_ = 0;
+
+    void Flush();
+};
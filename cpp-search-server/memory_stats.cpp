@@ -0,0 +1,45 @@
+#include "memory_stats.h"
+
+using std::string;
+using std::operator""s;
+
+size_t IndexMemoryStats::GetTotalBytes() const {
+    return stop_words.bytes + mutable_segment.bytes + frozen_segments.bytes + documents.bytes + removed_documents.bytes + fuzzy_index.bytes;
+}
+
+size_t EstimateTreeNodeBytes(size_t value_bytes) {
+    //red-black tree node: three links and a color, padded
+    return 4 * sizeof(void*) + value_bytes;
+}
+
+size_t EstimateHeapBytes(const string& str) {
+    const char* data = str.data();
+    const char* object = reinterpret_cast<const char*>(&str);
+    const bool is_inline = object <= data && data < object + sizeof(string);
+    return is_inline ? 0 : str.capacity() + 1;
+}
+
+std::ostream& operator<<(std::ostream& out, const IndexMemoryStats& stats) {
+    auto print_structure = [&out](const string& name, const StructureMemoryStats& structure) {
+        out << name << ": "s << structure.bytes << " bytes, "s << structure.objects << " objects"s << std::endl;
+    };
+    print_structure("stop_words"s, stats.stop_words);
+    print_structure("mutable_segment"s, stats.mutable_segment);
+    print_structure("frozen_segments"s, stats.frozen_segments);
+    print_structure("documents"s, stats.documents);
+    print_structure("removed_documents"s, stats.removed_documents);
+    print_structure("fuzzy_index"s, stats.fuzzy_index);
+    out << "total: "s << stats.GetTotalBytes() << " bytes"s << std::endl;
+    print_structure("cold_postings (mapped)"s, stats.cold_postings);
+    out << "segments: "s << stats.segment_count << ", vocabulary: "s << stats.vocabulary_size << std::endl;
+    out << "posting lengths:"s;
+    for (size_t bucket = 0; bucket < stats.posting_length_histogram.size(); ++bucket) {
+        out << " ["s << (size_t{1} << bucket) << ", "s << (size_t{1} << (bucket + 1)) << "): "s << stats.posting_length_histogram[bucket];
+    }
+    out << std::endl << "heaviest terms:"s;
+    for (const auto& term : stats.heaviest_terms) {
+        out << ' ' << term.word << " ("s << term.postings << ')';
+    }
+    out << std::endl;
+    return out;
+}
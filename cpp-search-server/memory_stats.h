@@ -0,0 +1,41 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Approximate memory use of one container: heap bytes including node overhead, and element count
+struct StructureMemoryStats {
+    size_t bytes = 0;
+    size_t objects = 0;
+};
+
+struct TermPostingCount {
+    std::string word;
+    size_t postings = 0;
+};
+
+//Returned by SearchServer::GetMemoryStats
+struct IndexMemoryStats {
+    StructureMemoryStats stop_words;
+    StructureMemoryStats mutable_segment;   //objects are postings
+    StructureMemoryStats frozen_segments;   //objects are postings
+    StructureMemoryStats documents;
+    StructureMemoryStats removed_documents; //tombstones waiting for a merge
+    StructureMemoryStats fuzzy_index;       //objects are deletion strings
+    StructureMemoryStats cold_postings;     //mapped from disk, not part of the total; objects are postings
+    size_t segment_count = 0;
+    size_t vocabulary_size = 0;
+    //bucket i counts words with a posting list length in [2^i, 2^(i + 1))
+    std::vector<size_t> posting_length_histogram;
+    //sorted by decreasing posting count
+    std::vector<TermPostingCount> heaviest_terms;
+
+    size_t GetTotalBytes() const;
+};
+
+//Heap size of a std::map / std::set node holding a value of value_bytes
+size_t EstimateTreeNodeBytes(size_t value_bytes);
+//Heap bytes owned by a string beyond sizeof(std::string), zero for short strings kept inline
+size_t EstimateHeapBytes(const std::string& str);
+
+std::ostream& operator<<(std::ostream& out, const IndexMemoryStats& stats);
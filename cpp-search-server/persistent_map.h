@@ -0,0 +1,240 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+//**************** Class Persistent Map ****************//
+// Ordered map whose copies share structure: a treap of immutable nodes, in which an insertion
+// or removal copies only the O(log n) nodes on the path to the changed key. Copying the map
+// copies one pointer, so copies of a large map are cheap and can be changed independently.
+// Priorities are hashes of the keys, so the shape of the tree depends only on its keys.
+// Nodes never change once built and can be read from any number of threads.
+template <typename Key, typename Value>
+class PersistentMap {
+public:
+    size_t GetSize() const;
+    bool Empty() const;
+    //nullptr if the key is absent
+    const Value* Find(const Key& key) const;
+    bool Contains(const Key& key) const;
+    //throws std::out_of_range if the key is absent
+    const Value& At(const Key& key) const;
+    //entry number index in key order, index must be less than the size
+    const std::pair<Key, Value>& GetNth(size_t index) const;
+    //replaces the value if the key is present
+    void InsertOrAssign(const Key& key, Value value);
+    //returns false if the key was absent
+    bool Erase(const Key& key);
+    void Clear();
+    //calls visitor(key, value) in key order
+    template <typename Visitor>
+    void ForEach(Visitor visitor) const;
+    //nodes shared with copies are counted too
+    size_t GetMemoryBytes() const;
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    struct Node {
+        std::pair<Key, Value> entry;
+        uint64_t priority = 0;
+        size_t size = 1;
+        NodePtr left;
+        NodePtr right;
+    };
+    //rough size of a node with its shared_ptr control block
+    static inline constexpr size_t NODE_BYTES = sizeof(Node) + 2 * sizeof(long);
+    NodePtr root_;
+
+    static uint64_t GetPriority(const Key& key);
+    static size_t GetSize(const NodePtr& node);
+    static NodePtr MakeNode(std::pair<Key, Value> entry, uint64_t priority, NodePtr left, NodePtr right);
+    //keys less than key go to the first tree
+    static std::pair<NodePtr, NodePtr> Split(const NodePtr& node, const Key& key);
+    //all keys of left must be less than the keys of right
+    static NodePtr Merge(const NodePtr& left, const NodePtr& right);
+    //key must be absent
+    static NodePtr Insert(const NodePtr& node, std::pair<Key, Value> entry, uint64_t priority);
+    //returns node itself if the key is absent
+    static NodePtr Erase(const NodePtr& node, const Key& key);
+    template <typename Visitor>
+    static void ForEach(const Node* node, Visitor& visitor);
+};
+
+//====== Template Definitions: ========================
+template <typename Key, typename Value>
+size_t PersistentMap<Key, Value>::GetSize() const {
+    return GetSize(root_);
+}
+
+template <typename Key, typename Value>
+bool PersistentMap<Key, Value>::Empty() const {
+    return root_ == nullptr;
+}
+
+template <typename Key, typename Value>
+const Value* PersistentMap<Key, Value>::Find(const Key& key) const {
+    const Node* node = root_.get();
+    while (node != nullptr) {
+        if (key < node->entry.first) {
+            node = node->left.get();
+        } else if (node->entry.first < key) {
+            node = node->right.get();
+        } else {
+            return &node->entry.second;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Key, typename Value>
+bool PersistentMap<Key, Value>::Contains(const Key& key) const {
+    return Find(key) != nullptr;
+}
+
+template <typename Key, typename Value>
+const Value& PersistentMap<Key, Value>::At(const Key& key) const {
+    const Value* value = Find(key);
+    if (value == nullptr) {
+        throw std::out_of_range("PersistentMap: key not found");
+    }
+    return *value;
+}
+
+template <typename Key, typename Value>
+const std::pair<Key, Value>& PersistentMap<Key, Value>::GetNth(size_t index) const {
+    const Node* node = root_.get();
+    while (true) {
+        const size_t left_size = GetSize(node->left);
+        if (index < left_size) {
+            node = node->left.get();
+        } else if (index == left_size) {
+            return node->entry;
+        } else {
+            index -= left_size + 1;
+            node = node->right.get();
+        }
+    }
+}
+
+template <typename Key, typename Value>
+void PersistentMap<Key, Value>::InsertOrAssign(const Key& key, Value value) {
+    root_ = Insert(Erase(root_, key), {key, std::move(value)}, GetPriority(key));
+}
+
+template <typename Key, typename Value>
+bool PersistentMap<Key, Value>::Erase(const Key& key) {
+    NodePtr root = Erase(root_, key);
+    if (root == root_) {
+        return false;
+    }
+    root_ = std::move(root);
+    return true;
+}
+
+template <typename Key, typename Value>
+void PersistentMap<Key, Value>::Clear() {
+    root_.reset();
+}
+
+template <typename Key, typename Value>
+template <typename Visitor>
+void PersistentMap<Key, Value>::ForEach(Visitor visitor) const {
+    ForEach(root_.get(), visitor);
+}
+
+template <typename Key, typename Value>
+size_t PersistentMap<Key, Value>::GetMemoryBytes() const {
+    return GetSize() * NODE_BYTES;
+}
+
+template <typename Key, typename Value>
+uint64_t PersistentMap<Key, Value>::GetPriority(const Key& key) {
+    //splitmix64 finalizer, std::hash of integers is usually the identity
+    uint64_t hash = static_cast<uint64_t>(std::hash<Key>{}(key)) + 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+template <typename Key, typename Value>
+size_t PersistentMap<Key, Value>::GetSize(const NodePtr& node) {
+    return node ? node->size : 0;
+}
+
+template <typename Key, typename Value>
+typename PersistentMap<Key, Value>::NodePtr PersistentMap<Key, Value>::MakeNode(std::pair<Key, Value> entry, uint64_t priority,
+                                                                               NodePtr left, NodePtr right) {
+    const size_t size = 1 + GetSize(left) + GetSize(right);
+    return std::make_shared<const Node>(Node{std::move(entry), priority, size, std::move(left), std::move(right)});
+}
+
+template <typename Key, typename Value>
+std::pair<typename PersistentMap<Key, Value>::NodePtr, typename PersistentMap<Key, Value>::NodePtr>
+PersistentMap<Key, Value>::Split(const NodePtr& node, const Key& key) {
+    if (!node) {
+        return {};
+    }
+    if (node->entry.first < key) {
+        auto [left, right] = Split(node->right, key);
+        return {MakeNode(node->entry, node->priority, node->left, std::move(left)), std::move(right)};
+    }
+    auto [left, right] = Split(node->left, key);
+    return {std::move(left), MakeNode(node->entry, node->priority, std::move(right), node->right)};
+}
+
+template <typename Key, typename Value>
+typename PersistentMap<Key, Value>::NodePtr PersistentMap<Key, Value>::Merge(const NodePtr& left, const NodePtr& right) {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    if (left->priority > right->priority) {
+        return MakeNode(left->entry, left->priority, left->left, Merge(left->right, right));
+    }
+    return MakeNode(right->entry, right->priority, Merge(left, right->left), right->right);
+}
+
+template <typename Key, typename Value>
+typename PersistentMap<Key, Value>::NodePtr PersistentMap<Key, Value>::Insert(const NodePtr& node, std::pair<Key, Value> entry,
+                                                                             uint64_t priority) {
+    if (!node || priority > node->priority) {
+        auto [left, right] = Split(node, entry.first);
+        return MakeNode(std::move(entry), priority, std::move(left), std::move(right));
+    }
+    if (entry.first < node->entry.first) {
+        return MakeNode(node->entry, node->priority, Insert(node->left, std::move(entry), priority), node->right);
+    }
+    return MakeNode(node->entry, node->priority, node->left, Insert(node->right, std::move(entry), priority));
+}
+
+template <typename Key, typename Value>
+typename PersistentMap<Key, Value>::NodePtr PersistentMap<Key, Value>::Erase(const NodePtr& node, const Key& key) {
+    if (!node) {
+        return node;
+    }
+    if (key < node->entry.first) {
+        NodePtr left = Erase(node->left, key);
+        return left == node->left ? node : MakeNode(node->entry, node->priority, std::move(left), node->right);
+    }
+    if (node->entry.first < key) {
+        NodePtr right = Erase(node->right, key);
+        return right == node->right ? node : MakeNode(node->entry, node->priority, node->left, std::move(right));
+    }
+    return Merge(node->left, node->right);
+}
+
+template <typename Key, typename Value>
+template <typename Visitor>
+void PersistentMap<Key, Value>::ForEach(const Node* node, Visitor& visitor) {
+    if (node == nullptr) {
+        return;
+    }
+    ForEach(node->left.get(), visitor);
+    visitor(node->entry.first, node->entry.second);
+    ForEach(node->right.get(), visitor);
+}
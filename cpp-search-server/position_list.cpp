@@ -0,0 +1,42 @@
+#include "position_list.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+void AppendVarint(string& encoded, uint32_t value) {
+    while (value >= 0x80) {
+        encoded.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    encoded.push_back(static_cast<char>(value));
+}
+
+string EncodePositions(const vector<uint32_t>& positions) {
+    string encoded;
+    uint32_t previous = 0;
+    for (const uint32_t position : positions) {
+        AppendVarint(encoded, position - previous);
+        previous = position;
+    }
+    return encoded;
+}
+
+void DecodePositions(string_view encoded, vector<uint32_t>& positions) {
+    positions.clear();
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const char c : encoded) {
+        const auto byte = static_cast<uint8_t>(c);
+        delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+}
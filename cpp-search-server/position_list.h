@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Positions of a word in a document are stored as deltas between increasing positions
+// (the first one from 0), each as a varint: 7 bits per byte, the high bit set on all bytes
+// but the last. Most deltas take a single byte.
+void AppendVarint(std::string& encoded, uint32_t value);
+//positions must be increasing
+std::string EncodePositions(const std::vector<uint32_t>& positions);
+//replaces the contents of positions
+void DecodePositions(std::string_view encoded, std::vector<uint32_t>& positions);
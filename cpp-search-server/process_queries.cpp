@@ -0,0 +1,22 @@
+#include "process_queries.h"
+
+using std::vector;
+using std::string;
+
+vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries, ThreadPool& thread_pool) {
+    vector<vector<Document>> results(queries.size());
+    thread_pool.ParallelFor(queries.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = search_server.FindTopDocuments(queries[i]);
+        }
+    });
+    return results;
+}
+
+vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries, ThreadPool& thread_pool) {
+    vector<Document> joined_results;
+    for (auto& documents : ProcessQueries(search_server, queries, thread_pool)) {
+        joined_results.insert(joined_results.end(), documents.begin(), documents.end());
+    }
+    return joined_results;
+}
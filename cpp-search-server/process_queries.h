@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+
+//FindTopDocuments for every query, run on the thread pool; results are in query order
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries,
+                                                  ThreadPool& thread_pool = GetDefaultThreadPool());
+//results of all queries in one vector, in query order
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server,
+                                           const std::vector<std::string>& queries,
+                                           ThreadPool& thread_pool = GetDefaultThreadPool());
@@ -0,0 +1,139 @@
+#include "query_log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#include "search_server.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+const string QUERY_LOG_HEADER = "search-server query log v2\n";
+
+void AppendVarint64(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+//returns false if the data ends inside the varint
+bool ReadVarint64(string_view& data, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; !data.empty() && shift < 64; shift += 7) {
+        const auto byte = static_cast<uint8_t>(data.front());
+        data.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadRecord(string_view& data, uint64_t previous_timestamp, QueryLogRecord& record) {
+    uint64_t timestamp_delta = 0, kind = 0, status = 0, result_count = 0, latency = 0, query_size = 0;
+    if (!ReadVarint64(data, timestamp_delta) || !ReadVarint64(data, kind) || !ReadVarint64(data, status)
+        || !ReadVarint64(data, result_count) || !ReadVarint64(data, latency) || !ReadVarint64(data, query_size)
+        || data.size() < query_size) {
+        return false;
+    }
+    record.timestamp = previous_timestamp + timestamp_delta;
+    record.kind = static_cast<QueryLogRecord::Kind>(kind);
+    record.status = static_cast<DocumentStatus>(status);
+    record.latency = static_cast<uint32_t>(latency);
+    record.query.assign(data.substr(0, query_size));
+    data.remove_prefix(query_size);
+    record.results.clear();
+    for (uint64_t i = 0; i < result_count; ++i) {
+        uint64_t id = 0, rating = 0;
+        Document document;
+        if (!ReadVarint64(data, id) || !ReadVarint64(data, rating) || data.size() < sizeof(double)) {
+            return false;
+        }
+        document.id = static_cast<int>(id);
+        //zigzag: non-negative ratings are even, negative ones odd
+        document.rating = static_cast<int>(static_cast<int64_t>(rating >> 1) ^ -static_cast<int64_t>(rating & 1));
+        std::memcpy(&document.relevance, data.data(), sizeof(double));
+        data.remove_prefix(sizeof(double));
+        record.results.push_back(document);
+    }
+    return true;
+}
+
+} // namespace
+
+bool AreSameResults(const vector<Document>& lhs, const vector<Document>& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& lhs, const Document& rhs) {
+        return lhs.id == rhs.id && lhs.rating == rhs.rating
+            && std::abs(lhs.relevance - rhs.relevance) < SearchServer::PRECISION_EPSILON;
+    });
+}
+
+//************* Class Query Log Writer *************//
+QueryLogWriter::QueryLogWriter(const string& path)
+: output_(path, std::ios::binary | std::ios::trunc) {
+    if (!output_) {
+        throw std::runtime_error(QUERY_LOG_OPEN_ERROR_MSG);
+    }
+    output_ << QUERY_LOG_HEADER;
+}
+
+void QueryLogWriter::Append(const QueryLogRecord& record) {
+    buffer_.clear();
+    //timestamps of one log do not decrease, the delta is clamped if the clock went back
+    AppendVarint64(buffer_, record.timestamp > previous_timestamp_ ? record.timestamp - previous_timestamp_ : 0);
+    AppendVarint64(buffer_, static_cast<uint64_t>(record.kind));
+    AppendVarint64(buffer_, static_cast<uint64_t>(record.status));
+    AppendVarint64(buffer_, record.results.size());
+    AppendVarint64(buffer_, record.latency);
+    AppendVarint64(buffer_, record.query.size());
+    buffer_ += record.query;
+    for (const Document& document : record.results) {
+        AppendVarint64(buffer_, static_cast<uint64_t>(document.id));
+        const auto rating = static_cast<int64_t>(document.rating);
+        AppendVarint64(buffer_, (static_cast<uint64_t>(rating) << 1) ^ static_cast<uint64_t>(rating >> 63));
+        char relevance[sizeof(double)];
+        std::memcpy(relevance, &document.relevance, sizeof(double));
+        buffer_.append(relevance, sizeof(double));
+    }
+    output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    previous_timestamp_ = std::max(previous_timestamp_, record.timestamp);
+    ++record_count_;
+}
+
+void QueryLogWriter::Flush() {
+    output_.flush();
+}
+
+uint64_t QueryLogWriter::GetRecordCount() const {
+    return record_count_;
+}
+
+//********** End of Class Query Log Writer **********//
+
+vector<QueryLogRecord> ReadQueryLog(const string& path) {
+    std::ifstream input(path, std::ios::binary);
+    const string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    string_view rest = data;
+    if (rest.substr(0, QUERY_LOG_HEADER.size()) != QUERY_LOG_HEADER) {
+        return {};
+    }
+    rest.remove_prefix(QUERY_LOG_HEADER.size());
+    vector<QueryLogRecord> records;
+    uint64_t previous_timestamp = 0;
+    QueryLogRecord record;
+    while (ReadRecord(rest, previous_timestamp, record)) {
+        previous_timestamp = record.timestamp;
+        records.push_back(record);
+    }
+    return records;
+}
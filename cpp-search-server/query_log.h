@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+//===== Query Log Error Messages =====================
+const std::string QUERY_LOG_OPEN_ERROR_MSG = "QueryLog ERROR: Cannot open query log file";
+
+struct QueryLogRecord {
+    //how the results were filtered; a custom predicate cannot be stored, only noted
+    enum class Kind : uint8_t {
+        DEFAULT,
+        STATUS,
+        PREDICATE,
+    };
+    uint64_t timestamp = 0;     //microseconds since the Unix epoch
+    Kind kind = Kind::DEFAULT;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::string query;
+    std::vector<Document> results;
+    uint32_t latency = 0;       //microseconds
+};
+
+//same ids and ratings in the same order, relevances closer than SearchServer::PRECISION_EPSILON
+bool AreSameResults(const std::vector<Document>& lhs, const std::vector<Document>& rhs);
+
+//************* Class Query Log Writer *************//
+// Compact binary log of search requests, for replaying real traffic.
+// The file starts with a header line; a record is [timestamp delta][kind][status][result count]
+// [latency][query size] as varints, then the query text and, for every result, [id][zigzag rating]
+// as varints and the 8-byte relevance.
+// A torn record at the end is dropped on reading. Not thread-safe.
+class QueryLogWriter {
+public:
+    //creates or truncates the file
+    explicit QueryLogWriter(const std::string& path);
+
+    void Append(const QueryLogRecord& record);
+    void Flush();
+    uint64_t GetRecordCount() const;
+
+private:
+    std::ofstream output_;
+    std::string buffer_;
+    uint64_t previous_timestamp_ = 0;
+    uint64_t record_count_ = 0;
+};
+
+//records are returned in the logged order; empty if the file is missing or not a query log
+std::vector<QueryLogRecord> ReadQueryLog(const std::string& path);
@@ -0,0 +1,177 @@
+#include "query_replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include "write_ahead_log.h"
+
+using std::string;
+using std::vector;
+using std::operator""s;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+uint64_t GetPercentile(const vector<uint64_t>& sorted_values, double fraction) {
+    if (sorted_values.empty()) {
+        return 0;
+    }
+    const auto index = static_cast<size_t>(fraction * static_cast<double>(sorted_values.size() - 1));
+    return sorted_values[index];
+}
+
+vector<Document> RunQuery(const SearchServer& server, const QueryLogRecord& record) {
+    switch (record.kind) {
+        case QueryLogRecord::Kind::DEFAULT:
+            return server.FindTopDocuments(record.query);
+        case QueryLogRecord::Kind::STATUS:
+            return server.FindTopDocuments(record.query, record.status);
+        case QueryLogRecord::Kind::PREDICATE:
+            break;
+    }
+    return server.FindTopDocuments(record.query, [](int, DocumentStatus, int) { return true; });
+}
+
+} // namespace
+
+ReplayReport ReplayQueryLog(const SearchServer& server, const vector<QueryLogRecord>& records,
+                            const ReplayOptions& options) {
+    struct ReplayedQuery {
+        bool is_failed = false;
+        uint64_t latency = 0;
+        QueryLogRecord record;
+    };
+    vector<ReplayedQuery> replayed(records.size());
+    std::atomic<size_t> next_record = 0;
+    const uint64_t first_timestamp = records.empty() ? 0 : records.front().timestamp;
+    const Clock::time_point start = Clock::now();
+    
+    auto replay = [&] {
+        for (size_t i = next_record++; i < records.size(); i = next_record++) {
+            const QueryLogRecord& record = records[i];
+            Clock::time_point scheduled = Clock::now();
+            if (options.speed > 0.0) {
+                const double offset = static_cast<double>(record.timestamp - first_timestamp) / options.speed;
+                scheduled = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(offset));
+                std::this_thread::sleep_until(scheduled);
+            }
+            ReplayedQuery& result = replayed[i];
+            result.record = record;
+            try {
+                result.record.results = RunQuery(server, record);
+            } catch (const std::exception&) {
+                result.is_failed = true;
+            }
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled);
+            result.latency = static_cast<uint64_t>(latency.count());
+            result.record.latency = static_cast<uint32_t>(result.latency);
+        }
+    };
+    vector<std::thread> threads;
+    for (size_t i = 1; i < std::max<size_t>(options.thread_count, 1); ++i) {
+        threads.emplace_back(replay);
+    }
+    replay();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    ReplayReport report;
+    report.query_count = records.size();
+    report.duration_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (report.duration_seconds > 0.0) {
+        report.queries_per_second = static_cast<double>(records.size()) / report.duration_seconds;
+    }
+    vector<uint64_t> latencies;
+    latencies.reserve(replayed.size());
+    std::optional<QueryLogWriter> record_log;
+    if (!options.record_path.empty()) {
+        record_log.emplace(options.record_path);
+    }
+    for (size_t i = 0; i < replayed.size(); ++i) {
+        const ReplayedQuery& query = replayed[i];
+        latencies.push_back(query.latency);
+        if (record_log) {
+            record_log->Append(query.record);
+        }
+        if (query.is_failed) {
+            ++report.failed_queries;
+            report.differing_records.push_back(i);
+        } else if (query.record.kind != QueryLogRecord::Kind::PREDICATE) {
+            ++report.compared_queries;
+            if (!AreSameResults(query.record.results, records[i].results)) {
+                report.differing_records.push_back(i);
+            }
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    report.latency_p50 = GetPercentile(latencies, 0.5);
+    report.latency_p90 = GetPercentile(latencies, 0.9);
+    report.latency_p99 = GetPercentile(latencies, 0.99);
+    report.latency_max = latencies.empty() ? 0 : latencies.back();
+    return report;
+}
+
+std::ostream& operator<<(std::ostream& out, const ReplayReport& report) {
+    out << "queries: "s << report.query_count << " in "s << report.duration_seconds << " s, "s
+        << report.queries_per_second << " queries/s"s << std::endl;
+    out << "latency, us: p50 "s << report.latency_p50 << ", p90 "s << report.latency_p90
+        << ", p99 "s << report.latency_p99 << ", max "s << report.latency_max << std::endl;
+    out << "compared: "s << report.compared_queries << ", failed: "s << report.failed_queries
+        << ", differing: "s << report.differing_records.size() << std::endl;
+    return out;
+}
+
+int RunReplayTool(const vector<string>& arguments) {
+    const string usage = "usage: --replay <corpus log> <query log> [--speed N] [--threads N] [--record <path>]"
+                         " [--stop-words \"<words>\"] [--positional]"s;
+    if (arguments.size() < 2) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    ReplayOptions options;
+    string stop_words;
+    bool positional_index = false;
+    try {
+        for (size_t i = 2; i < arguments.size(); ++i) {
+            const string& option = arguments[i];
+            if (option == "--positional"s) {
+                positional_index = true;
+                continue;
+            }
+            if (i + 1 == arguments.size()) {
+                throw std::invalid_argument(option);
+            }
+            const string& value = arguments[++i];
+            if (option == "--speed"s) {
+                options.speed = std::stod(value);
+            } else if (option == "--threads"s) {
+                options.thread_count = std::stoul(value);
+            } else if (option == "--record"s) {
+                options.record_path = value;
+            } else if (option == "--stop-words"s) {
+                stop_words = value;
+            } else {
+                throw std::invalid_argument(option);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    
+    SearchServer server(stop_words);
+    if (positional_index) {
+        server.EnablePositionalIndex();
+    }
+    const size_t document_count = ReplayWriteAheadLog(arguments[0], server);
+    const auto records = ReadQueryLog(arguments[1]);
+    std::cerr << "corpus: "s << document_count << " documents, query log: "s << records.size() << " records"s << std::endl;
+    const ReplayReport report = ReplayQueryLog(server, records, options);
+    std::cout << report;
+    return report.differing_records.empty() ? 0 : 2;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "query_log.h"
+#include "search_server.h"
+
+struct ReplayOptions {
+    //multiple of the logged rate; 0 replays back to back, without waiting
+    double speed = 1.0;
+    size_t thread_count = 1;
+    //if not empty, the replayed requests are logged there, e.g. to compare two other builds
+    std::string record_path;
+};
+
+struct ReplayReport {
+    size_t query_count = 0;
+    size_t failed_queries = 0;      //threw, e.g. a query this build cannot parse
+    double duration_seconds = 0.0;
+    double queries_per_second = 0.0;
+    //microseconds from the scheduled start, so waiting for a busy thread is included
+    uint64_t latency_p50 = 0;
+    uint64_t latency_p90 = 0;
+    uint64_t latency_p99 = 0;
+    uint64_t latency_max = 0;
+    //requests with a custom predicate are replayed without filtering and not compared
+    size_t compared_queries = 0;
+    std::vector<size_t> differing_records; //indices of records with other results, see AreSameResults
+};
+
+// Replays the log open-loop: record i is started at its logged time offset divided by speed,
+// whether or not earlier requests have finished, by the first free of thread_count threads.
+ReplayReport ReplayQueryLog(const SearchServer& server, const std::vector<QueryLogRecord>& records,
+                            const ReplayOptions& options);
+
+std::ostream& operator<<(std::ostream& out, const ReplayReport& report);
+
+// Command line replay tool: cpp-search-server --replay <corpus log> <query log> [--speed N]
+//     [--threads N] [--record <path>] [--stop-words "<words>"] [--positional]
+// The corpus is a write-ahead log of the documents (see SetWriteAheadLog). Returns the exit code.
+int RunReplayTool(const std::vector<std::string>& arguments);
@@ -0,0 +1,15 @@
+#include "remove_duplicates.h"
+
+#include <iostream>
+
+using std::vector;
+using std::operator""s;
+
+vector<int> RemoveDuplicates(SearchServer& search_server) {
+    const vector<int> duplicate_ids = search_server.FindDuplicateDocumentIds();
+    for (const int document_id : duplicate_ids) {
+        std::cout << "Found duplicate document id "s << document_id << std::endl;
+        search_server.RemoveDocument(document_id);
+    }
+    return duplicate_ids;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <vector>
+
+#include "search_server.h"
+
+//removes documents with the same set of words as a document with a lower id,
+//prints and returns the removed ids
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
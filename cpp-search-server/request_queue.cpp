@@ -9,18 +9,31 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
 , current_time_(0) {
 }
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-    const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(static_cast<int>(result.size()));
-    return result;
+    return RunRequest(QueryLogRecord::Kind::STATUS, status, raw_query, [&] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
 }
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
-    const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(static_cast<int>(result.size()));
-    return result;
+    return RunRequest(QueryLogRecord::Kind::DEFAULT, DocumentStatus::ACTUAL, raw_query, [&] {
+        return search_server_.FindTopDocuments(raw_query);
+    });
+}
+vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query, DocumentStatus status) {
+    return RunRequest(QueryLogRecord::Kind::STATUS, status, query.GetRawQuery(), [&] {
+        return search_server_.FindTopDocuments(query, status);
+    });
+}
+vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query) {
+    return RunRequest(QueryLogRecord::Kind::DEFAULT, DocumentStatus::ACTUAL, query.GetRawQuery(), [&] {
+        return search_server_.FindTopDocuments(query);
+    });
 }
 int RequestQueue::GetNoResultRequests() const {
     return no_results_requests_;
 }
+void RequestQueue::SetQueryLog(std::shared_ptr<QueryLogWriter> query_log) {
+    query_log_ = std::move(query_log);
+}
 
 //============== Private Methods ==============
 void RequestQueue::AddRequest(int results_num) {
@@ -39,3 +52,16 @@ void RequestQueue::AddRequest(int results_num) {
         ++no_results_requests_;
     }
 }
+
+void RequestQueue::LogRequest(QueryLogRecord::Kind kind, DocumentStatus status, const string& raw_query,
+                              std::chrono::steady_clock::duration latency, const vector<Document>& result) {
+    using namespace std::chrono;
+    QueryLogRecord record;
+    record.timestamp = static_cast<uint64_t>(duration_cast<microseconds>(system_clock::now().time_since_epoch()).count());
+    record.kind = kind;
+    record.status = status;
+    record.query = raw_query;
+    record.results = result;
+    record.latency = static_cast<uint32_t>(duration_cast<microseconds>(latency).count());
+    query_log_->Append(record);
+}
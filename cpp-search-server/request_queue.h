@@ -1,7 +1,10 @@
 #pragma once
+#include <chrono>
 #include <deque>
+#include <memory>
 #include <string>
 
+#include "query_log.h"
 #include "search_server.h"
 
 class RequestQueue {
@@ -11,7 +14,13 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const PreparedQuery& query, DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(const PreparedQuery& query, DocumentStatus status);
+    std::vector<Document> AddFindRequest(const PreparedQuery& query);
     int GetNoResultRequests() const;
+    //every request is recorded with its timestamp, results and latency
+    void SetQueryLog(std::shared_ptr<QueryLogWriter> query_log);
 private:
     struct QueryResult {
         uint64_t timestamp;
@@ -22,14 +31,37 @@ private:
     int no_results_requests_;
     uint64_t current_time_;
     const static int min_in_day_ = 1440;
+    std::shared_ptr<QueryLogWriter> query_log_;
  
+    template <typename Search>
+    std::vector<Document> RunRequest(QueryLogRecord::Kind kind, DocumentStatus status, const std::string& raw_query, Search search);
     void AddRequest(int results_num);
+    void LogRequest(QueryLogRecord::Kind kind, DocumentStatus status, const std::string& raw_query,
+                    std::chrono::steady_clock::duration latency, const std::vector<Document>& result);
 };
 
 //====== Template Definitions: ========================
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    return RunRequest(QueryLogRecord::Kind::PREDICATE, DocumentStatus::ACTUAL, raw_query, [&] {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::AddFindRequest(const PreparedQuery& query, DocumentPredicate document_predicate) {
+    return RunRequest(QueryLogRecord::Kind::PREDICATE, DocumentStatus::ACTUAL, query.GetRawQuery(), [&] {
+        return search_server_.FindTopDocuments(query, document_predicate);
+    });
+}
+
+template <typename Search>
+std::vector<Document> RequestQueue::RunRequest(QueryLogRecord::Kind kind, DocumentStatus status, const std::string& raw_query, Search search) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = search();
+    if (query_log_) {
+        LogRequest(kind, status, raw_query, std::chrono::steady_clock::now() - start, result);
+    }
+    AddRequest(static_cast<int>(result.size()));
     return result;
 }
@@ -0,0 +1,83 @@
+#include "score_precision_report.h"
+
+using std::vector;
+using std::string;
+using std::operator""s;
+
+ScorePrecisionReport CompareScorePrecision(const SearchServer& reference_server, TermFreqPrecision precision,
+                                           const vector<string>& queries) {
+    SearchServer exact_server = reference_server;
+    exact_server.SetTermFreqPrecision(TermFreqPrecision::DOUBLE);
+    exact_server.RebuildSegments();
+    SearchServer reduced_server = reference_server;
+    reduced_server.SetTermFreqPrecision(precision);
+    reduced_server.RebuildSegments();
+    
+    const auto any_document = [](int, DocumentStatus, int) { return true; };
+    ScorePrecisionReport report;
+    report.precision = precision;
+    int compared_documents = 0;
+    double error_sum = 0.0;
+    for (const string& query : queries) {
+        const auto expected = exact_server.FindTopDocuments(query, any_document);
+        const auto found_docs = reduced_server.FindTopDocuments(query, any_document);
+        ++report.query_count;
+        
+        bool is_identical = expected.size() == found_docs.size();
+        for (size_t i = 0; i < std::max(expected.size(), found_docs.size()); ++i) {
+            if (i >= expected.size() || i >= found_docs.size() || expected[i].id != found_docs[i].id) {
+                ++report.changed_positions;
+                is_identical = false;
+            }
+        }
+        if (is_identical) {
+            ++report.identical_rankings;
+        }
+        for (const Document& expected_document : expected) {
+            const auto it = std::find_if(found_docs.begin(), found_docs.end(), [&expected_document](const Document& document) {
+                return document.id == expected_document.id;
+            });
+            if (it == found_docs.end()) {
+                continue;
+            }
+            const double error = std::abs(it->relevance - expected_document.relevance);
+            report.max_relevance_error = std::max(report.max_relevance_error, error);
+            error_sum += error;
+            ++compared_documents;
+            if (error >= SearchServer::PRECISION_EPSILON) {
+                ++report.errors_above_epsilon;
+            }
+        }
+    }
+    if (compared_documents > 0) {
+        report.mean_relevance_error = error_sum / compared_documents;
+    }
+    return report;
+}
+
+std::ostream& operator<<(std::ostream& out, TermFreqPrecision precision) {
+    switch (precision) {
+        case TermFreqPrecision::DOUBLE:
+            return out << "DOUBLE"s;
+        case TermFreqPrecision::FLOAT:
+            return out << "FLOAT"s;
+        case TermFreqPrecision::IMPACT_16:
+            return out << "IMPACT_16"s;
+        case TermFreqPrecision::IMPACT_8:
+            return out << "IMPACT_8"s;
+    }
+    return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const ScorePrecisionReport& report) {
+    out << "{ "s
+    << "precision = "s << report.precision << ", "s
+    << "queries = "s << report.query_count << ", "s
+    << "identical_rankings = "s << report.identical_rankings << ", "s
+    << "changed_positions = "s << report.changed_positions << ", "s
+    << "errors_above_epsilon = "s << report.errors_above_epsilon << ", "s
+    << "max_relevance_error = "s << report.max_relevance_error << ", "s
+    << "mean_relevance_error = "s << report.mean_relevance_error
+    << " }"s;
+    return out;
+}
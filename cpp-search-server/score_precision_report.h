@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+//Accuracy of a reduced term frequency precision against the exact (DOUBLE) index.
+//Rankings are compared on FindTopDocuments results, which break ties within PRECISION_EPSILON by rating.
+struct ScorePrecisionReport {
+    TermFreqPrecision precision = TermFreqPrecision::DOUBLE;
+    int query_count = 0;
+    int identical_rankings = 0;     //same documents in the same order
+    int changed_positions = 0;      //result positions holding a different document
+    int errors_above_epsilon = 0;   //common documents with relevance error >= PRECISION_EPSILON
+    double max_relevance_error = 0.0;
+    double mean_relevance_error = 0.0;
+};
+
+//Builds a copy of reference_server re-encoded with the given precision and runs all queries
+//against both, counting documents of every status.
+ScorePrecisionReport CompareScorePrecision(const SearchServer& reference_server, TermFreqPrecision precision,
+                                           const std::vector<std::string>& queries);
+
+std::ostream& operator<<(std::ostream& out, TermFreqPrecision precision);
+std::ostream& operator<<(std::ostream& out, const ScorePrecisionReport& report);
@@ -1,5 +1,8 @@
 #include "search_server.h"
 
+#include <limits>
+#include <unistd.h>
+
 using std::vector;
 using std::set;
 using std::map;
@@ -8,6 +11,58 @@ using std::string;
 using std::ostream;
 using std::cerr;
 using std::endl;
+using std::operator""sv;
+
+namespace {
+
+//erases the posting of the document, and the word once it has no postings
+template <typename Postings>
+void EraseMutablePosting(map<string, Postings>& word_to_postings, const string& word, int document_id) {
+    if (const auto it = word_to_postings.find(word); it != word_to_postings.end()) {
+        it->second.erase(document_id);
+        if (it->second.empty()) {
+            word_to_postings.erase(it);
+        }
+    }
+}
+
+} // namespace
+
+//**************** Class Prepared Query ****************//
+const vector<string>& PreparedQuery::GetPlusWords() const {
+    return plus_words_;
+}
+
+const vector<string>& PreparedQuery::GetMinusWords() const {
+    return minus_words_;
+}
+
+const string& PreparedQuery::GetRawQuery() const {
+    return raw_query_;
+}
+
+bool PreparedQuery::ResolvedWord::Contains(int document_id) const {
+    if (mutable_postings != nullptr && mutable_postings->count(document_id) > 0) {
+        return true;
+    }
+    return std::any_of(segment_postings.begin(), segment_postings.end(), [document_id](const PostingList& postings) {
+        return postings.Contains(document_id);
+    });
+}
+
+std::string_view PreparedQuery::ResolvedWord::FindPositions(int document_id) const {
+    if (mutable_positions != nullptr) {
+        if (const auto it = mutable_positions->find(document_id); it != mutable_positions->end()) {
+            return it->second;
+        }
+    }
+    for (const PostingList& postings : segment_postings) {
+        if (const size_t index = postings.Find(document_id); index < postings.size && postings.HasPositions()) {
+            return postings.GetPositions(index);
+        }
+    }
+    return {};
+}
 
 //**************** Class Search Server ****************//
 //====== Constructors ==============================
@@ -20,33 +75,624 @@ set<string> SearchServer::ParseStopWordsStr(const string& stop_words_text) {
    return MakeUniqueNonEmptyStrings(all_words);
 }
 
+//====== Copy & move: ================================
+// A copy or a moved-to server gets a new index version: queries prepared against the object
+// before are looked up again, instead of reading postings of the previous contents.
+// The moved-from server changes too, its postings now belong to the other object.
+SearchServer::SearchServer(const SearchServer& other)
+: stop_words_(other.stop_words_)
+, word_to_document_freqs_(other.word_to_document_freqs_)
+, word_to_document_positions_(other.word_to_document_positions_)
+, mutable_segment_document_words_(other.mutable_segment_document_words_)
+, segments_(other.segments_)
+, removed_document_ids_(other.removed_document_ids_)
+, mutable_segment_limit_(other.mutable_segment_limit_)
+, term_freq_precision_(other.term_freq_precision_)
+, inline_segment_merging_(other.inline_segment_merging_)
+, positional_index_(other.positional_index_)
+, cold_storage_directory_(other.cold_storage_directory_)
+, max_resident_posting_bytes_(other.max_resident_posting_bytes_)
+, max_word_expansions_(other.max_word_expansions_)
+, deletion_index_(other.deletion_index_)
+, fuzzy_relevance_penalty_(other.fuzzy_relevance_penalty_)
+, write_ahead_log_(other.write_ahead_log_)
+, log_sequence_number_(other.log_sequence_number_)
+, documents_(other.documents_)
+, duplicate_detection_(other.duplicate_detection_)
+, fingerprint_to_document_id_(other.fingerprint_to_document_id_)
+, dropped_duplicate_ids_(other.dropped_duplicate_ids_)
+, index_version_(NextIndexVersion()) {
+}
+
+SearchServer::SearchServer(SearchServer&& other)
+: stop_words_(std::move(other.stop_words_))
+, word_to_document_freqs_(std::move(other.word_to_document_freqs_))
+, word_to_document_positions_(std::move(other.word_to_document_positions_))
+, mutable_segment_document_words_(std::move(other.mutable_segment_document_words_))
+, segments_(std::move(other.segments_))
+, removed_document_ids_(std::move(other.removed_document_ids_))
+, mutable_segment_limit_(std::move(other.mutable_segment_limit_))
+, term_freq_precision_(std::move(other.term_freq_precision_))
+, inline_segment_merging_(std::move(other.inline_segment_merging_))
+, positional_index_(std::move(other.positional_index_))
+, cold_storage_directory_(std::move(other.cold_storage_directory_))
+, max_resident_posting_bytes_(std::move(other.max_resident_posting_bytes_))
+, max_word_expansions_(std::move(other.max_word_expansions_))
+, deletion_index_(std::move(other.deletion_index_))
+, fuzzy_relevance_penalty_(std::move(other.fuzzy_relevance_penalty_))
+, write_ahead_log_(std::move(other.write_ahead_log_))
+, log_sequence_number_(other.log_sequence_number_)
+, documents_(std::move(other.documents_))
+, duplicate_detection_(std::move(other.duplicate_detection_))
+, fingerprint_to_document_id_(std::move(other.fingerprint_to_document_id_))
+, dropped_duplicate_ids_(std::move(other.dropped_duplicate_ids_))
+, index_version_(NextIndexVersion()) {
+    other.MarkIndexChanged();
+}
+
+SearchServer& SearchServer::operator=(const SearchServer& other) {
+    if (this != &other) {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+
+SearchServer& SearchServer::operator=(SearchServer&& other) {
+    if (this == &other) {
+        return *this;
+    }
+    stop_words_ = std::move(other.stop_words_);
+    word_to_document_freqs_ = std::move(other.word_to_document_freqs_);
+    word_to_document_positions_ = std::move(other.word_to_document_positions_);
+    mutable_segment_document_words_ = std::move(other.mutable_segment_document_words_);
+    segments_ = std::move(other.segments_);
+    removed_document_ids_ = std::move(other.removed_document_ids_);
+    mutable_segment_limit_ = std::move(other.mutable_segment_limit_);
+    term_freq_precision_ = std::move(other.term_freq_precision_);
+    inline_segment_merging_ = std::move(other.inline_segment_merging_);
+    positional_index_ = std::move(other.positional_index_);
+    cold_storage_directory_ = std::move(other.cold_storage_directory_);
+    max_resident_posting_bytes_ = std::move(other.max_resident_posting_bytes_);
+    max_word_expansions_ = std::move(other.max_word_expansions_);
+    deletion_index_ = std::move(other.deletion_index_);
+    fuzzy_relevance_penalty_ = std::move(other.fuzzy_relevance_penalty_);
+    write_ahead_log_ = std::move(other.write_ahead_log_);
+    log_sequence_number_ = other.log_sequence_number_;
+    documents_ = std::move(other.documents_);
+    duplicate_detection_ = std::move(other.duplicate_detection_);
+    fingerprint_to_document_id_ = std::move(other.fingerprint_to_document_id_);
+    dropped_duplicate_ids_ = std::move(other.dropped_duplicate_ids_);
+    MarkIndexChanged();
+    other.MarkIndexChanged();
+    return *this;
+}
+
 //====== Get&Set functions: =========================
 int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+    return static_cast<int>(documents_.GetSize());
 }
 
 int SearchServer::GetDocumentId(int doc_number) const {
-    if(doc_number < 0 || doc_number >= documents_.size()) {
+    if(doc_number < 0 || doc_number >= documents_.GetSize()) {
         throw std::out_of_range("Document number is out of range!");
     }
-    auto nth_document = documents_.begin();
-    advance(nth_document, doc_number);
-    return nth_document->first; //returns id of nth document
+    return documents_.GetNth(doc_number).first; //returns id of nth document
 }
 
 void SearchServer::AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
+    TRACE_SPAN("AddDocument");
     if(document_id < 0) {
         throw std::invalid_argument(INVALID_ID_MSG);
     }
-    const auto words = SplitIntoWordsNoStop(document);
-    if((documents_.count(document_id) > 0)) {
+    vector<string> words;
+    vector<uint32_t> positions;
+    {
+        TRACE_SPAN("SplitIntoWords");
+        words = SplitIntoWordsNoStop(document, positional_index_ ? &positions : nullptr);
+    }
+    AddSplitDocument(document_id, document, words, positions, status, ratings);
+}
+
+void SearchServer::AddDocuments(const vector<NewDocument>& documents, ThreadPool& thread_pool) {
+    //splitting only reads the stop words, the index is changed by this thread only
+    vector<vector<string>> document_words(documents.size());
+    vector<vector<uint32_t>> document_positions(documents.size());
+    vector<std::exception_ptr> split_errors(documents.size());
+    thread_pool.ParallelFor(documents.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                document_words[i] = SplitIntoWordsNoStop(documents[i].text, positional_index_ ? &document_positions[i] : nullptr);
+            } catch (...) {
+                split_errors[i] = std::current_exception();
+            }
+        }
+    });
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (documents[i].id < 0) {
+            throw std::invalid_argument(INVALID_ID_MSG);
+        }
+        if (split_errors[i]) {
+            std::rethrow_exception(split_errors[i]);
+        }
+        AddSplitDocument(documents[i].id, documents[i].text, document_words[i], document_positions[i],
+                         documents[i].status, documents[i].ratings);
+    }
+}
+
+void SearchServer::AddSplitDocument(int document_id, const string& document, const vector<string>& words,
+                                    const vector<uint32_t>& positions, DocumentStatus status, const vector<int>& ratings) {
+    if(documents_.Contains(document_id)) {
         throw std::invalid_argument(EXISTING_ID_MSG);
     }
-    const double inv_word_count = 1.0 / words.size();
-    for (const string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+    if(IsRemoved(document_id)) {
+        throw std::invalid_argument(REMOVED_ID_PENDING_MSG);
+    }
+    const uint64_t word_set_fingerprint = ComputeWordSetFingerprint(words);
+    int replaced_id = -1;
+    if (duplicate_detection_) {
+        if (const int* stored_id = fingerprint_to_document_id_.Find(word_set_fingerprint)) {
+            if (*stored_id < document_id) {
+                dropped_duplicate_ids_.push_back(document_id);
+                return;
+            }
+            replaced_id = *stored_id;
+        }
+    }
+    //one record for the addition and the removal of the duplicate, logged before either is applied,
+    //so a failed append changes nothing and a replay cannot apply only one of them
+    if (write_ahead_log_) {
+        TRACE_SPAN("AppendWriteAheadLog");
+        WalRecord record{WalRecord::Kind::ADD_DOCUMENT, document_id, status, ratings, document};
+        record.replaced_document_id = replaced_id;
+        log_sequence_number_ = write_ahead_log_->Append(std::move(record));
+    }
+    if (replaced_id >= 0) {
+        dropped_duplicate_ids_.push_back(replaced_id);
+        EraseDocument(replaced_id);
+    }
+    {
+        TRACE_SPAN("InsertPostings");
+        const double inv_word_count = 1.0 / words.size();
+        for (const string& word : words) {
+            word_to_document_freqs_[word][document_id] += inv_word_count;
+        }
+    }
+    if (positional_index_) {
+        TRACE_SPAN("InsertPositions");
+        //positions of a word are appended in increasing order, as deltas from the previous one
+        std::unordered_map<std::string_view, uint32_t> previous_positions;
+        for (size_t i = 0; i < words.size(); ++i) {
+            const auto [it, is_first] = previous_positions.try_emplace(words[i], 0);
+            AppendVarint(word_to_document_positions_[words[i]][document_id], positions[i] - it->second);
+            it->second = positions[i];
+        }
+    }
+    if (deletion_index_) {
+        TRACE_SPAN("UpdateDeletionIndex");
+        for (const string& word : words) {
+            deletion_index_->AddWord(word);
+        }
+    }
+    TRACE_COUNTER("words_indexed", words.size());
+    vector<string> distinct_words = words;
+    std::sort(distinct_words.begin(), distinct_words.end());
+    distinct_words.erase(std::unique(distinct_words.begin(), distinct_words.end()), distinct_words.end());
+    mutable_segment_document_words_.emplace(document_id, std::move(distinct_words));
+    documents_.InsertOrAssign(document_id, DocumentData{ComputeAverageRating(ratings), status, word_set_fingerprint});
+    if (duplicate_detection_) {
+        fingerprint_to_document_id_.InsertOrAssign(word_set_fingerprint, document_id);
+    }
+    MarkIndexChanged();
+    
+    if (mutable_segment_document_words_.size() >= mutable_segment_limit_) {
+        FreezeMutableSegment();
+        if (inline_segment_merging_) {
+            MergeSegments();
+        }
+    }
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    if(!documents_.Contains(document_id)) {
+        throw std::invalid_argument(INVALID_ID_MSG);
+    }
+    if (write_ahead_log_) {
+        log_sequence_number_ = write_ahead_log_->Append({WalRecord::Kind::REMOVE_DOCUMENT, document_id, {}, {}, {}});
+    }
+    EraseDocument(document_id);
+}
+
+void SearchServer::EraseDocument(int document_id) {
+    if (duplicate_detection_) {
+        const uint64_t word_set_fingerprint = documents_.At(document_id).word_set_fingerprint;
+        if (const int* stored_id = fingerprint_to_document_id_.Find(word_set_fingerprint); stored_id && *stored_id == document_id) {
+            fingerprint_to_document_id_.Erase(word_set_fingerprint);
+        }
+    }
+    documents_.Erase(document_id);
+    if (const auto it = mutable_segment_document_words_.find(document_id); it != mutable_segment_document_words_.end()) {
+        for (const string& word : it->second) {
+            EraseMutablePosting(word_to_document_freqs_, word, document_id);
+            EraseMutablePosting(word_to_document_positions_, word, document_id);
+        }
+        mutable_segment_document_words_.erase(it);
+    } else {
+        //postings are dropped when the frozen segment holding them is merged
+        removed_document_ids_.insert(document_id);
+    }
+    MarkIndexChanged();
+}
+
+bool SearchServer::IsRemovalPending(int document_id) const {
+    return IsRemoved(document_id);
+}
+
+void SearchServer::SetWriteAheadLog(std::shared_ptr<WriteAheadLog> write_ahead_log) {
+    write_ahead_log_ = std::move(write_ahead_log);
+}
+
+uint64_t SearchServer::GetLogSequenceNumber() const {
+    return log_sequence_number_;
+}
+
+void SearchServer::SetLogSequenceNumber(uint64_t sequence_number) {
+    log_sequence_number_ = sequence_number;
+}
+
+//====== Duplicates: ================================
+uint64_t SearchServer::GetWordSetFingerprint(int document_id) const {
+    const DocumentData* document_data = documents_.Find(document_id);
+    if (document_data == nullptr) {
+        throw std::invalid_argument(INVALID_ID_MSG);
+    }
+    return document_data->word_set_fingerprint;
+}
+
+vector<int> SearchServer::FindDuplicateDocumentIds() const {
+    vector<int> duplicate_ids;
+    std::unordered_map<uint64_t, int> fingerprint_to_document_id;
+    fingerprint_to_document_id.reserve(documents_.GetSize());
+    //documents_ is sorted by id, the first document with a fingerprint is kept
+    documents_.ForEach([&](int document_id, const DocumentData& document_data) {
+        if (!fingerprint_to_document_id.emplace(document_data.word_set_fingerprint, document_id).second) {
+            duplicate_ids.push_back(document_id);
+        }
+    });
+    return duplicate_ids;
+}
+
+void SearchServer::SetDuplicateDetection(bool enabled) {
+    duplicate_detection_ = enabled;
+    fingerprint_to_document_id_.Clear();
+    if (enabled) {
+        //the lowest id of each fingerprint is kept, as ids are visited in increasing order
+        documents_.ForEach([this](int document_id, const DocumentData& document_data) {
+            if (!fingerprint_to_document_id_.Contains(document_data.word_set_fingerprint)) {
+                fingerprint_to_document_id_.InsertOrAssign(document_data.word_set_fingerprint, document_id);
+            }
+        });
+    }
+}
+
+vector<int> SearchServer::TakeDroppedDuplicateIds() {
+    return std::exchange(dropped_duplicate_ids_, {});
+}
+
+//====== Index Segments: ============================
+void SearchServer::SetMutableSegmentLimit(size_t max_documents) {
+    mutable_segment_limit_ = std::max<size_t>(max_documents, 1);
+}
+
+void SearchServer::SetInlineSegmentMerging(bool enabled) {
+    inline_segment_merging_ = enabled;
+}
+
+void SearchServer::SetTermFreqPrecision(TermFreqPrecision precision) {
+    term_freq_precision_ = precision;
+}
+
+void SearchServer::RebuildSegments() {
+    FreezeMutableSegment();
+    if (segments_.empty()) {
+        return;
+    }
+    const SegmentMergePlan plan{segments_, removed_document_ids_, term_freq_precision_};
+    ApplySegmentMerge(plan, ExecuteSegmentMerge(plan));
+}
+
+void SearchServer::FreezeMutableSegment() {
+    TRACE_SPAN("FreezeMutableSegment");
+    if (!word_to_document_freqs_.empty()) {
+        auto segment = IndexSegment::Build(word_to_document_freqs_, removed_document_ids_, term_freq_precision_,
+                                           positional_index_ ? &word_to_document_positions_ : nullptr);
+        if (segment->GetDocumentCount() > 0) {
+            segments_.push_back(std::move(segment));
+        }
+    }
+    word_to_document_freqs_.clear();
+    word_to_document_positions_.clear();
+    mutable_segment_document_words_.clear();
+    PurgeRemovedDocumentIds();
+    MarkIndexChanged();
+    RebalanceTiersIfOverLimit();
+}
+
+size_t SearchServer::GetSegmentCount() const {
+    return segments_.size();
+}
+
+SearchServer::SegmentMergePlan SearchServer::PlanSegmentMerge() const {
+    //tier of a segment is floor(log(document count)) with base SEGMENT_MERGE_FACTOR
+    map<int, vector<std::shared_ptr<const IndexSegment>>> segments_by_tier;
+    for (const auto& segment : segments_) {
+        int tier = 0;
+        for (size_t count = segment->GetDocumentCount(); count >= SEGMENT_MERGE_FACTOR; count /= SEGMENT_MERGE_FACTOR) {
+            ++tier;
+        }
+        segments_by_tier[tier].push_back(segment);
+    }
+    SegmentMergePlan plan;
+    for (auto& [tier, tier_segments] : segments_by_tier) {
+        if (tier_segments.size() >= SEGMENT_MERGE_FACTOR) {
+            tier_segments.resize(SEGMENT_MERGE_FACTOR);
+            plan.segments = std::move(tier_segments);
+            plan.removed_document_ids = removed_document_ids_;
+            plan.precision = term_freq_precision_;
+            break;
+        }
+    }
+    return plan;
+}
+
+std::shared_ptr<const IndexSegment> SearchServer::ExecuteSegmentMerge(const SegmentMergePlan& plan) {
+    return IndexSegment::Merge(plan.segments, plan.removed_document_ids, plan.precision);
+}
+
+bool SearchServer::ApplySegmentMerge(const SegmentMergePlan& plan, std::shared_ptr<const IndexSegment> merged_segment) {
+    if (plan.segments.empty()) {
+        return false;
+    }
+    vector<size_t> positions;
+    for (const auto& segment : plan.segments) {
+        const auto it = std::find(segments_.begin(), segments_.end(), segment);
+        if (it == segments_.end()) {
+            return false;
+        }
+        positions.push_back(it - segments_.begin());
+    }
+    std::sort(positions.begin(), positions.end());
+    const size_t first_position = positions.front();
+    for (auto it = positions.rbegin(); it != positions.rend(); ++it) {
+        segments_.erase(segments_.begin() + *it);
+    }
+    if (merged_segment->GetDocumentCount() > 0) {
+        segments_.insert(segments_.begin() + first_position, std::move(merged_segment));
+    }
+    PurgeRemovedDocumentIds();
+    MarkIndexChanged();
+    RebalanceTiersIfOverLimit();
+    return true;
+}
+
+void SearchServer::MergeSegments() {
+    TRACE_SPAN("MergeSegments");
+    for (auto plan = PlanSegmentMerge(); !plan.segments.empty(); plan = PlanSegmentMerge()) {
+        ApplySegmentMerge(plan, ExecuteSegmentMerge(plan));
+    }
+}
+
+//====== Memory Statistics: =========================
+IndexMemoryStats SearchServer::GetMemoryStats(size_t heaviest_terms_count) const {
+    IndexMemoryStats stats;
+    stats.stop_words.bytes = stop_words_.GetMemoryBytes();
+    stats.stop_words.objects = stop_words_.GetSize();
+    
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        stats.mutable_segment.bytes += EstimateTreeNodeBytes(sizeof(std::pair<const string, map<int, double>>)) + EstimateHeapBytes(word)
+            + document_freqs.size() * EstimateTreeNodeBytes(sizeof(std::pair<const int, double>));
+        stats.mutable_segment.objects += document_freqs.size();
+    }
+    for (const auto& [word, document_positions] : word_to_document_positions_) {
+        stats.mutable_segment.bytes += EstimateTreeNodeBytes(sizeof(std::pair<const string, map<int, string>>)) + EstimateHeapBytes(word);
+        for (const auto& [document_id, positions] : document_positions) {
+            stats.mutable_segment.bytes += EstimateTreeNodeBytes(sizeof(std::pair<const int, string>)) + EstimateHeapBytes(positions);
+        }
+    }
+    for (const auto& [document_id, words] : mutable_segment_document_words_) {
+        stats.mutable_segment.bytes += EstimateTreeNodeBytes(sizeof(std::pair<const int, vector<string>>))
+            + words.capacity() * sizeof(string);
+        for (const string& word : words) {
+            stats.mutable_segment.bytes += EstimateHeapBytes(word);
+        }
+    }
+    
+    for (const auto& segment : segments_) {
+        stats.frozen_segments.bytes += segment->GetMemoryBytes();
+        stats.frozen_segments.objects += segment->GetPostingCount() - segment->GetColdPostingCount();
+        stats.cold_postings.bytes += segment->GetColdFileBytes();
+        stats.cold_postings.objects += segment->GetColdPostingCount();
+    }
+    stats.segment_count = segments_.size();
+    
+    stats.documents.bytes = documents_.GetMemoryBytes() + fingerprint_to_document_id_.GetMemoryBytes();
+    stats.documents.objects = documents_.GetSize();
+    stats.removed_documents.bytes = removed_document_ids_.size() * EstimateTreeNodeBytes(sizeof(int));
+    stats.removed_documents.objects = removed_document_ids_.size();
+    if (deletion_index_) {
+        stats.fuzzy_index.bytes = deletion_index_->GetMemoryBytes();
+        stats.fuzzy_index.objects = deletion_index_->GetDeletionCount();
+    }
+    
+    //min-heap of the heaviest terms seen so far, words are copied only when kept
+    auto is_heavier = [](const TermPostingCount& lhs, const TermPostingCount& rhs) {
+        return lhs.postings > rhs.postings;
+    };
+    ForEachIndexedWord(""sv, [&](std::string_view word, size_t posting_count) {
+        ++stats.vocabulary_size;
+        size_t bucket = 0;
+        while ((posting_count >> (bucket + 1)) > 0) {
+            ++bucket;
+        }
+        if (stats.posting_length_histogram.size() <= bucket) {
+            stats.posting_length_histogram.resize(bucket + 1, 0);
+        }
+        ++stats.posting_length_histogram[bucket];
+        
+        if (stats.heaviest_terms.size() < heaviest_terms_count) {
+            stats.heaviest_terms.push_back({string(word), posting_count});
+            std::push_heap(stats.heaviest_terms.begin(), stats.heaviest_terms.end(), is_heavier);
+        } else if (heaviest_terms_count > 0 && posting_count > stats.heaviest_terms.front().postings) {
+            std::pop_heap(stats.heaviest_terms.begin(), stats.heaviest_terms.end(), is_heavier);
+            stats.heaviest_terms.back() = {string(word), posting_count};
+            std::push_heap(stats.heaviest_terms.begin(), stats.heaviest_terms.end(), is_heavier);
+        }
+        return true;
+    });
+    std::sort_heap(stats.heaviest_terms.begin(), stats.heaviest_terms.end(), is_heavier);
+    return stats;
+}
+
+//====== Wildcard Queries: ==========================
+void SearchServer::SetMaxWordExpansions(size_t max_expansions) {
+    max_word_expansions_ = max_expansions;
+    //prepared queries have to be expanded again
+    MarkIndexChanged();
+}
+
+//====== Typo-Tolerant Matching: ====================
+void SearchServer::EnableFuzzyMatching(int max_edit_distance, double relevance_penalty) {
+    if (max_edit_distance < 1 || max_edit_distance > MAX_FUZZY_EDIT_DISTANCE
+        || !(relevance_penalty > 0.0 && relevance_penalty <= 1.0)) {
+        throw std::invalid_argument(FUZZY_SETTINGS_MSG);
+    }
+    if (!deletion_index_ || deletion_index_->GetMaxEditDistance() != max_edit_distance) {
+        DeletionIndex deletion_index(max_edit_distance);
+        ForEachIndexedWord(""sv, [&deletion_index](std::string_view word, size_t) {
+            deletion_index.AddWord(word);
+            return true;
+        });
+        deletion_index_ = std::move(deletion_index);
+    }
+    fuzzy_relevance_penalty_ = relevance_penalty;
+    MarkIndexChanged();
+}
+
+void SearchServer::DisableFuzzyMatching() {
+    deletion_index_.reset();
+    MarkIndexChanged();
+}
+
+//====== Positional Index: ==========================
+void SearchServer::EnablePositionalIndex() {
+    if (!documents_.Empty() || !segments_.empty() || !word_to_document_freqs_.empty()) {
+        throw std::invalid_argument(POSITIONAL_INDEX_NOT_EMPTY_MSG);
+    }
+    positional_index_ = true;
+}
+
+bool SearchServer::HasPositionalIndex() const {
+    return positional_index_;
+}
+
+//====== Tiered Posting Storage: ====================
+void SearchServer::EnableTieredStorage(const string& directory, size_t max_resident_bytes) {
+    if (directory.empty()) {
+        throw std::invalid_argument(TIERED_STORAGE_SETTINGS_MSG);
+    }
+    cold_storage_directory_ = directory;
+    max_resident_posting_bytes_ = max_resident_bytes;
+    RebalanceTiers();
+}
+
+void SearchServer::DisableTieredStorage() {
+    for (auto& segment : segments_) {
+        if (segment->GetColdPostingCount() > 0) {
+            segment = IndexSegment::Retier(*segment, vector<bool>(segment->GetWordCount(), true), {});
+        }
+    }
+    cold_storage_directory_.clear();
+    MarkIndexChanged();
+}
+
+void SearchServer::RebalanceTiers() {
+    if (cold_storage_directory_.empty()) {
+        return;
+    }
+    TRACE_SPAN("RebalanceTiers");
+    struct WordRank {
+        uint32_t access_count = 0;
+        size_t posting_bytes = 0;
+        size_t segment_index = 0;
+        size_t word_index = 0;
+    };
+    vector<WordRank> words;
+    vector<vector<bool>> is_hot(segments_.size());
+    for (size_t segment_index = 0; segment_index < segments_.size(); ++segment_index) {
+        const IndexSegment& segment = *segments_[segment_index];
+        is_hot[segment_index].resize(segment.GetWordCount(), false);
+        for (size_t word_index = 0; word_index < segment.GetWordCount(); ++word_index) {
+            words.push_back({segment.GetAccessCount(word_index), segment.GetPostingBytes(word_index), segment_index, word_index});
+        }
+    }
+    std::sort(words.begin(), words.end(), [](const WordRank& lhs, const WordRank& rhs) {
+        return std::tie(rhs.access_count, lhs.posting_bytes) < std::tie(lhs.access_count, rhs.posting_bytes);
+    });
+    //a word that does not fit is skipped, smaller ones after it can still fill the budget
+    size_t resident_bytes = 0;
+    for (const WordRank& word : words) {
+        if (resident_bytes + word.posting_bytes <= max_resident_posting_bytes_) {
+            resident_bytes += word.posting_bytes;
+            is_hot[word.segment_index][word.word_index] = true;
+        }
+    }
+    size_t retiered_segments = 0;
+    for (size_t segment_index = 0; segment_index < segments_.size(); ++segment_index) {
+        auto& segment = segments_[segment_index];
+        bool is_changed = false;
+        for (size_t word_index = 0; word_index < segment->GetWordCount() && !is_changed; ++word_index) {
+            is_changed = is_hot[segment_index][word_index] == segment->IsCold(word_index);
+        }
+        if (is_changed) {
+            segment = IndexSegment::Retier(*segment, is_hot[segment_index], MakeColdFilePath());
+            ++retiered_segments;
+        }
+        segment->DecayAccessCounts();
+    }
+    TRACE_COUNTER("retiered_segments", retiered_segments);
+    //words and postings stay the same, but prepared queries point into the replaced segments;
+    //a rebalance that moves nothing keeps them valid
+    if (retiered_segments > 0) {
+        MarkIndexChanged();
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+}
+
+//====== Prepared Queries: ==========================
+PreparedQuery SearchServer::Prepare(const string& raw_query) const {
+    TRACE_SPAN("Prepare");
+    Query query;
+    {
+        TRACE_SPAN("ParseQuery");
+        query = ParseQuery(raw_query);
+    }
+    PreparedQuery prepared_query;
+    prepared_query.raw_query_ = raw_query;
+    prepared_query.plus_words_.assign(query.plus_words.begin(), query.plus_words.end());
+    prepared_query.minus_words_.assign(query.minus_words.begin(), query.minus_words.end());
+    prepared_query.positional_constraints_ = std::move(query.positional_constraints);
+    ResolvePreparedQuery(prepared_query);
+    return prepared_query;
+}
+
+bool SearchServer::IsUpToDate(const PreparedQuery& query) const {
+    return query.server_ == this && query.index_version_ == index_version_;
+}
+
+bool SearchServer::Refresh(PreparedQuery& query) const {
+    if (IsUpToDate(query)) {
+        return true;
+    }
+    ResolvePreparedQuery(query);
+    return false;
 }
 
 //====== Find Top Documents: ========================
@@ -60,34 +706,69 @@ vector<Document> SearchServer::FindTopDocuments(const string& raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments(query, [status](int document_id, DocumentStatus document_status, int rating) {
+                                return document_status == status;
+                            });
+}
+
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
 //====== Match Document: ============================
 std::tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(const string& raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
-    
-    if(document_id < 0 || documents_.count(document_id) == 0) {
+    TRACE_SPAN("MatchDocument");
+    return MatchDocument(Prepare(raw_query), document_id);
+}
+
+std::tuple<vector<string>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    TRACE_SPAN("MatchPrepared");
+    if(document_id < 0 || !documents_.Contains(document_id)) {
         throw std::invalid_argument(INVALID_ID_MSG);
     }
+    if (!IsUpToDate(query)) {
+        PreparedQuery refreshed_query = query;
+        ResolvePreparedQuery(refreshed_query);
+        return MatchDocument(refreshed_query, document_id);
+    }
     
-    std::tuple<vector<string>, DocumentStatus> result{{}, documents_.at(document_id).status};
+    std::tuple<vector<string>, DocumentStatus> result{vector<string>{}, documents_.At(document_id).status};
     vector<string>& matched_words = std::get<0>(result);
     
-    //loop in minus words first
-    for (const string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id)) {
-            return result; //will return empty vector
-        }
+    //check minus words first
+    if (query.excluded_documents_.Contains(document_id)) {
+        return result; //will return empty vector
+    }
+    if (!query.positional_constraints_.empty() && !MatchesPositionalConstraints(query, document_id)) {
+        return result;
     } //if no minus words found, loop in plus words:
-    for (const string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    for (size_t i = 0; i < query.resolved_plus_words_.size(); ++i) {
+        if (query.resolved_plus_words_[i].Contains(document_id)) {
+            matched_words.push_back(query.resolved_plus_words_[i].word);
         }
     }
     return result;
 }
 
 //====== Private Methods: ============================
-bool SearchServer::IsStopWord(const string& word) const {
-    return stop_words_.count(word) > 0;
+bool SearchServer::IsStopWord(std::string_view word) const {
+    return stop_words_.Contains(word);
+}
+
+bool SearchServer::IsRemoved(int document_id) const {
+    return !removed_document_ids_.empty() && removed_document_ids_.count(document_id) > 0;
+}
+
+void SearchServer::PurgeRemovedDocumentIds() {
+    for (auto it = removed_document_ids_.begin(); it != removed_document_ids_.end(); ) {
+        const int document_id = *it;
+        const bool is_stored = mutable_segment_document_words_.count(document_id) > 0
+            || std::any_of(segments_.begin(), segments_.end(), [document_id](const auto& segment) {
+                   return segment->ContainsDocument(document_id);
+               });
+        it = is_stored ? std::next(it) : removed_document_ids_.erase(it);
+    }
 }
 
 vector<string> SearchServer::ParseStringInput(const string& text) const {
@@ -114,12 +795,15 @@ vector<string> SearchServer::ParseStringInput(const string& text) const {
     return words;
 }
 
-vector<string> SearchServer::SplitIntoWordsNoStop(const string& text) const {
+vector<string> SearchServer::SplitIntoWordsNoStop(const string& text, vector<uint32_t>* positions) const {
     vector<string> words;
     const auto split_text = ParseStringInput(text);
-    for (const string& word : split_text) {
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+    for (size_t i = 0; i < split_text.size(); ++i) {
+        if (!IsStopWord(split_text[i])) {
+            words.push_back(split_text[i]);
+            if (positions != nullptr) {
+                positions->push_back(static_cast<uint32_t>(i));
+            }
         }
     }
     return words;
@@ -141,10 +825,80 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string text) const {
 }
 
 SearchServer::Query SearchServer::ParseQuery(const string& text) const {
+    using Constraint = PreparedQuery::PositionalConstraint;
     Query query;
     const auto qwords = ParseStringInput(text);
+    //NEAR/k operator: returns k, or nullopt if the word is not an operator
+    auto parse_near = [](const string& word) -> std::optional<uint32_t> {
+        static const string prefix = "NEAR/";
+        if (word.size() <= prefix.size() || word.compare(0, prefix.size(), prefix) != 0
+            || !std::all_of(word.begin() + prefix.size(), word.end(), [](char c) { return '0' <= c && c <= '9'; })) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(std::stoul(word.substr(prefix.size())));
+    };
+    //plain plus word allowed next to NEAR/k
+    auto is_near_operand = [&](size_t index) {
+        return index < qwords.size() && qwords[index][0] != '-' && qwords[index][0] != '"'
+            && !IsWildcardPattern(qwords[index]) && !parse_near(qwords[index]);
+    };
     
-    for (const string& word : qwords) {
+    //without the positional index quotes and NEAR/k are plain characters, as before it existed
+    for (size_t i = 0; i < qwords.size(); ++i) {
+        const string& word = qwords[i];
+        if (positional_index_ && word[0] == '"') {
+            //phrase until the word ending with a quote, which may be this one
+            Constraint phrase;
+            uint32_t offset = 0;
+            bool is_closed = false;
+            for (size_t first = i; i < qwords.size() && !is_closed; ++i) {
+                string phrase_word = qwords[i];
+                if (i == first) {
+                    phrase_word.erase(0, 1);
+                }
+                if (!phrase_word.empty() && phrase_word.back() == '"') {
+                    phrase_word.pop_back();
+                    is_closed = true;
+                }
+                if (phrase_word.empty()) {
+                    continue; //quote separated from the words by spaces
+                }
+                if (phrase_word[0] == '-' || phrase_word.find('"') != string::npos || IsWildcardPattern(phrase_word)) {
+                    throw std::invalid_argument(QUERY_POSITIONAL_FORMAT_MSG);
+                }
+                if (!IsStopWord(phrase_word)) {
+                    query.plus_words.insert(phrase_word);
+                    phrase.words.push_back(std::move(phrase_word));
+                    phrase.offsets.push_back(offset);
+                }
+                ++offset;
+            }
+            if (!is_closed) {
+                throw std::invalid_argument(QUERY_POSITIONAL_FORMAT_MSG);
+            }
+            --i;
+            if (phrase.words.size() > 1) {
+                query.positional_constraints.push_back(std::move(phrase));
+            }
+            continue;
+        }
+        if (const auto max_distance = positional_index_ ? parse_near(word) : std::nullopt) {
+            if (i == 0 || !is_near_operand(i - 1) || !is_near_operand(i + 1)) {
+                throw std::invalid_argument(QUERY_POSITIONAL_FORMAT_MSG);
+            }
+            //a stop word on either side makes the operator a no-op
+            if (!IsStopWord(qwords[i - 1]) && !IsStopWord(qwords[i + 1])) {
+                Constraint near;
+                near.kind = Constraint::Kind::NEAR;
+                near.words = {qwords[i - 1], qwords[i + 1]};
+                near.max_distance = *max_distance;
+                query.positional_constraints.push_back(std::move(near));
+            }
+            continue;
+        }
+        if (positional_index_ && word.size() > 1 && word[0] == '-' && word[1] == '"') {
+            throw std::invalid_argument(QUERY_POSITIONAL_FORMAT_MSG);
+        }
         const QueryWord query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
@@ -157,9 +911,242 @@ SearchServer::Query SearchServer::ParseQuery(const string& text) const {
     return query;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+bool SearchServer::MatchesPositionalConstraints(const PreparedQuery& query, int document_id) const {
+    using Constraint = PreparedQuery::PositionalConstraint;
+    vector<std::string_view> encoded_positions;
+    vector<vector<uint32_t>> positions;
+    for (const Constraint& constraint : query.positional_constraints_) {
+        //term-level check first, positions are decoded only if all words are in the document
+        encoded_positions.clear();
+        for (const auto& word : constraint.resolved_words) {
+            encoded_positions.push_back(word.FindPositions(document_id));
+            if (encoded_positions.back().empty()) {
+                return false;
+            }
+        }
+        positions.resize(encoded_positions.size());
+        for (size_t i = 0; i < encoded_positions.size(); ++i) {
+            DecodePositions(encoded_positions[i], positions[i]);
+        }
+        
+        bool is_matched = false;
+        if (constraint.kind == Constraint::Kind::PHRASE) {
+            //every occurrence of the first word is a possible phrase start
+            for (const uint32_t first_position : positions[0]) {
+                if (first_position < constraint.offsets[0]) {
+                    continue;
+                }
+                const uint32_t start = first_position - constraint.offsets[0];
+                is_matched = true;
+                for (size_t i = 1; i < positions.size() && is_matched; ++i) {
+                    is_matched = std::binary_search(positions[i].begin(), positions[i].end(), start + constraint.offsets[i]);
+                }
+                if (is_matched) {
+                    break;
+                }
+            }
+        } else {
+            const auto& lhs = positions[0];
+            const auto& rhs = positions[1];
+            if (constraint.words[0] == constraint.words[1]) {
+                //two different occurrences of the same word
+                for (size_t i = 1; i < lhs.size() && !is_matched; ++i) {
+                    is_matched = lhs[i] - lhs[i - 1] <= constraint.max_distance;
+                }
+            } else {
+                //merge of the two sorted lists, the closest pair is always adjacent in the merge
+                for (size_t i = 0, j = 0; i < lhs.size() && j < rhs.size() && !is_matched; ) {
+                    if (lhs[i] < rhs[j]) {
+                        is_matched = rhs[j] - lhs[i] <= constraint.max_distance;
+                        ++i;
+                    } else {
+                        is_matched = lhs[i] - rhs[j] <= constraint.max_distance;
+                        ++j;
+                    }
+                }
+            }
+        }
+        if (!is_matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+set<string> SearchServer::ExpandQueryWords(const vector<string>& query_words, size_t max_expansions) const {
+    set<string> words;
+    for (const string& query_word : query_words) {
+        if (!IsWildcardPattern(query_word)) {
+            words.insert(query_word);
+            continue;
+        }
+        size_t expansion_count = 0;
+        ForEachIndexedWord(GetWildcardPrefix(query_word), [&](std::string_view word, size_t) {
+            if (expansion_count >= max_expansions) {
+                return false;
+            }
+            if (MatchesWildcardPattern(word, query_word)) {
+                words.emplace(word);
+                ++expansion_count;
+            }
+            return true;
+        });
+    }
+    return words;
+}
+
+PreparedQuery::ResolvedWord SearchServer::ResolveWord(const string& word) const {
+    PreparedQuery::ResolvedWord resolved_word;
+    resolved_word.word = word;
+    size_t posting_count = 0;
+    if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+        resolved_word.mutable_postings = &it->second;
+        posting_count += it->second.size();
+    }
+    if (const auto it = word_to_document_positions_.find(word); it != word_to_document_positions_.end()) {
+        resolved_word.mutable_positions = &it->second;
+    }
+    for (const auto& segment : segments_) {
+        const PostingList postings = segment->FindPostings(word);
+        if (!postings.Empty()) {
+            resolved_word.segment_postings.push_back(postings);
+            posting_count += postings.size;
+        }
+    }
+    //postings of removed documents are not counted, tombstones are usually few
+    if (posting_count > 0 && !removed_document_ids_.empty()) {
+        if (removed_document_ids_.size() < posting_count) {
+            for (const int document_id : removed_document_ids_) {
+                posting_count -= resolved_word.Contains(document_id) ? 1 : 0;
+            }
+        } else {
+            posting_count = 0;
+            ForEachPosting<double>(resolved_word, [&posting_count](int, double) { ++posting_count; });
+        }
+    }
+    resolved_word.documents_with_word = static_cast<int>(posting_count);
+    if (posting_count > 0) {
+        resolved_word.inverse_document_freq = ComputeInverseDocumentFreq(resolved_word.documents_with_word);
+    }
+    return resolved_word;
+}
+
+vector<PreparedQuery::ResolvedWord> SearchServer::ResolveCorrections(const string& word) const {
+    TRACE_SPAN("CorrectWord");
+    //words of removed documents stay in the deletion index, only words with live documents are candidates
+    map<string, PreparedQuery::ResolvedWord, std::less<>> live_words;
+    const auto closest_words = deletion_index_->FindClosestWords(word, [this, &live_words](std::string_view candidate) {
+        if (live_words.count(candidate) > 0) {
+            return true;
+        }
+        auto resolved_word = ResolveWord(string(candidate));
+        if (resolved_word.documents_with_word == 0) {
+            return false;
+        }
+        live_words.emplace(candidate, std::move(resolved_word));
+        return true;
+    });
+    vector<PreparedQuery::ResolvedWord> corrections;
+    for (const auto& [corrected_word, edit_distance] : closest_words) {
+        auto& resolved_word = live_words.at(corrected_word);
+        resolved_word.inverse_document_freq *= std::pow(fuzzy_relevance_penalty_, edit_distance);
+        corrections.push_back(std::move(resolved_word));
+    }
+    return corrections;
+}
+
+void SearchServer::ResolvePreparedQuery(PreparedQuery& query) const {
+    TRACE_SPAN("ResolvePostings");
+    //a corrected word can also be in the query, the exact one is kept
+    map<string, PreparedQuery::ResolvedWord> plus_words;
+    for (const string& word : ExpandQueryWords(query.plus_words_, max_word_expansions_)) {
+        auto resolved_word = ResolveWord(word);
+        if (resolved_word.documents_with_word == 0 && deletion_index_) {
+            for (auto& correction : ResolveCorrections(word)) {
+                plus_words.try_emplace(correction.word, std::move(correction));
+            }
+        } else {
+            plus_words.insert_or_assign(word, std::move(resolved_word));
+        }
+    }
+    query.resolved_plus_words_.clear();
+    for (auto& [word, resolved_word] : plus_words) {
+        query.resolved_plus_words_.push_back(std::move(resolved_word));
+    }
+    {
+        TRACE_SPAN("ExcludeMinusWords");
+        //postings of removed documents are included, they are never scored anyway
+        vector<int> excluded_document_ids;
+        //not capped, a document with any matching word must be excluded
+        for (const string& word : ExpandQueryWords(query.minus_words_, std::numeric_limits<size_t>::max())) {
+            if (const auto it = word_to_document_freqs_.find(word); it != word_to_document_freqs_.end()) {
+                for (const auto& [document_id, term_freq] : it->second) {
+                    excluded_document_ids.push_back(document_id);
+                }
+            }
+            for (const auto& segment : segments_) {
+                const PostingList postings = segment->FindPostings(word);
+                excluded_document_ids.insert(excluded_document_ids.end(), postings.document_ids, postings.document_ids + postings.size);
+            }
+        }
+        TRACE_COUNTER("excluded_documents", excluded_document_ids.size());
+        query.excluded_documents_ = DocumentIdSet(std::move(excluded_document_ids));
+    }
+    for (auto& constraint : query.positional_constraints_) {
+        constraint.resolved_words.clear();
+        for (const string& word : constraint.words) {
+            constraint.resolved_words.push_back(ResolveWord(word));
+        }
+    }
+    query.server_ = this;
+    query.index_version_ = index_version_;
+}
+
+// Existence required: documents_with_word > 0
+double SearchServer::ComputeInverseDocumentFreq(int documents_with_word) const {
+    return log(GetDocumentCount() * 1.0 / documents_with_word);
+}
+
+uint64_t SearchServer::NextIndexVersion() {
+    static std::atomic<uint64_t> last_version = 0;
+    return ++last_version;
+}
+
+void SearchServer::MarkIndexChanged() {
+    index_version_ = NextIndexVersion();
+}
+
+void SearchServer::RebalanceTiersIfOverLimit() {
+    if (cold_storage_directory_.empty()) {
+        return;
+    }
+    size_t resident_bytes = 0;
+    for (const auto& segment : segments_) {
+        resident_bytes += segment->GetHotPostingBytes();
+    }
+    if (resident_bytes > max_resident_posting_bytes_) {
+        RebalanceTiers();
+    }
+}
+
+string SearchServer::MakeColdFilePath() const {
+    //versions are unique within the process
+    return cold_storage_directory_ + "/segment-" + std::to_string(getpid()) + "-" + std::to_string(NextIndexVersion()) + ".cold";
+}
+
+uint64_t SearchServer::ComputeWordSetFingerprint(const vector<string>& words) {
+    vector<std::string_view> distinct_words(words.begin(), words.end());
+    std::sort(distinct_words.begin(), distinct_words.end());
+    distinct_words.erase(std::unique(distinct_words.begin(), distinct_words.end()), distinct_words.end());
+    uint64_t fingerprint = distinct_words.size();
+    for (const std::string_view word : distinct_words) {
+        //splitmix64 finalizer, so that similar sets get unrelated fingerprints
+        fingerprint += std::hash<std::string_view>{}(word) + 0x9e3779b97f4a7c15;
+        fingerprint = (fingerprint ^ (fingerprint >> 30)) * 0xbf58476d1ce4e5b9;
+        fingerprint = (fingerprint ^ (fingerprint >> 27)) * 0x94d049bb133111eb;
+        fingerprint ^= fingerprint >> 31;
+    }
+    return fingerprint;
 }
 
 inline int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -1,25 +1,100 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "deletion_index.h"
 #include "document.h"
+#include "document_id_set.h"
+#include "index_segment.h"
+#include "memory_stats.h"
+#include "persistent_map.h"
+#include "position_list.h"
 #include "read_input_functions.h"
+#include "stop_word_set.h"
 #include "string_processing.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "write_ahead_log.h"
 
 //===== Server Error Messages =======================
 const std::string INVALID_ID_MSG = "SearchServer ERROR: Invalid DocumentID";
 const std::string EXISTING_ID_MSG = "SearchServer ERROR: Adding duplicate DocumentID";
+const std::string REMOVED_ID_PENDING_MSG = "SearchServer ERROR: DocumentID was removed and is still stored in a segment, merge segments before reusing it";
 const std::string INPUT_INVALID_SYMBOLS_MSG = "SearchServer ERROR: Invalid symbols in input";
+const std::string FUZZY_SETTINGS_MSG = "SearchServer ERROR: Fuzzy matching needs an edit distance of 1 or 2 and a relevance penalty in (0, 1]";
 const std::string QUERY_WRONG_FORMAT_MSG = "SearchServer ERROR: Incorrect minus-word format used: [-] without word or [--] detected";
+const std::string QUERY_POSITIONAL_FORMAT_MSG = "SearchServer ERROR: Incorrect phrase or NEAR/k format: unclosed quote, minus or wildcard word in a phrase, or NEAR/k without a word on each side";
+const std::string POSITIONAL_INDEX_NOT_EMPTY_MSG = "SearchServer ERROR: Positional index can only be enabled before documents are added";
+const std::string TIERED_STORAGE_SETTINGS_MSG = "SearchServer ERROR: Tiered storage needs a directory for the cold files";
+
+class SearchServer;
+
+//**************** Class Prepared Query ****************//
+// Query parsed once by SearchServer::Prepare, with postings and IDFs looked up in that server.
+// It can be reused for any number of calls: if the server has changed since the lookup
+// (or another server is used), postings are looked up again from the stored words,
+// without parsing the query text. Wildcard words are expanded again on every lookup.
+class PreparedQuery {
+public:
+    const std::vector<std::string>& GetPlusWords() const;
+    const std::vector<std::string>& GetMinusWords() const;
+    //text the query was prepared from
+    const std::string& GetRawQuery() const;
+    
+private:
+    friend class SearchServer;
+    //postings handles of one word in every segment of the server
+    struct ResolvedWord {
+        std::string word;
+        int documents_with_word = 0;
+        //includes the relevance penalty of a corrected word
+        double inverse_document_freq = 0.0;
+        const std::map<int, double>* mutable_postings = nullptr;
+        const std::map<int, std::string>* mutable_positions = nullptr;
+        std::vector<PostingList> segment_postings;
+        
+        bool Contains(int document_id) const;
+        //encoded positions, empty if the word is not in the document
+        std::string_view FindPositions(int document_id) const;
+    };
+    //quoted phrase or NEAR/k, a document must satisfy all constraints of the query
+    struct PositionalConstraint {
+        enum class Kind {
+            PHRASE,
+            NEAR,
+        };
+        Kind kind = Kind::PHRASE;
+        std::vector<std::string> words;
+        std::vector<uint32_t> offsets;     //PHRASE: position of each word in the phrase, stop words included
+        uint32_t max_distance = 0;         //NEAR: of the two words
+        std::vector<ResolvedWord> resolved_words;
+    };
+    //as written in the query, including wildcard patterns
+    std::string raw_query_;
+    std::vector<std::string> plus_words_;
+    std::vector<std::string> minus_words_;
+    //indexed plus words matching the query words, sorted and without duplicates
+    std::vector<ResolvedWord> resolved_plus_words_;
+    //documents with any minus word, resolved before plus words are scanned
+    DocumentIdSet excluded_documents_;
+    std::vector<PositionalConstraint> positional_constraints_;
+    const SearchServer* server_ = nullptr;
+    uint64_t index_version_ = 0;
+};
 
 //**************** Class Search Server ****************//
 class SearchServer {
@@ -27,42 +102,218 @@ public:
 //====== Constants =================================
     static inline constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
     static inline constexpr double PRECISION_EPSILON = 1e-6;
+    static inline constexpr size_t DEFAULT_MUTABLE_SEGMENT_LIMIT = 1024;
+    static inline constexpr size_t SEGMENT_MERGE_FACTOR = 4;
+    static inline constexpr size_t DEFAULT_MAX_WORD_EXPANSIONS = 64;
+    static inline constexpr int MAX_FUZZY_EDIT_DISTANCE = 2;
+    static inline constexpr double DEFAULT_FUZZY_RELEVANCE_PENALTY = 0.5;
 //====== Constructors & constructor helpers: =======
     explicit SearchServer(const std::string& stop_words_text);
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
+    //the stop word table was built at compile time and is only copied
+    template <size_t N>
+    explicit SearchServer(const StaticStopWordSet<N>& stop_words);
     //need this version to avoid checking each word twice in case of a string
     std::set<std::string> ParseStopWordsStr(const std::string& stop_words_text);
     template<typename StringContainer>
     std::set<std::string> ParseStopWords(const StringContainer& stop_words);
+    //every copy or move gets a new index version, see IsUpToDate
+    SearchServer(const SearchServer& other);
+    SearchServer(SearchServer&& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer& operator=(SearchServer&& other);
 //====== Get&Set functions: =========================
     int GetDocumentCount() const;
     int GetDocumentId(int doc_number) const;
     void AddDocument(int document_id, const std::string& document, DocumentStatus status,
                      const std::vector<int>& ratings);
+    // Documents are split into words on the thread pool and inserted in order;
+    // stops at the first invalid document, as a loop of AddDocument calls would
+    void AddDocuments(const std::vector<NewDocument>& documents, ThreadPool& thread_pool = GetDefaultThreadPool());
+    void RemoveDocument(int document_id);
+    //true if the document was removed but its postings are still stored, so the id cannot be reused yet
+    bool IsRemovalPending(int document_id) const;
+    //every accepted AddDocument & RemoveDocument is logged before it is applied
+    void SetWriteAheadLog(std::shared_ptr<WriteAheadLog> write_ahead_log);
+    //sequence number of the last logged change in the server, stored with it in snapshots
+    uint64_t GetLogSequenceNumber() const;
+    void SetLogSequenceNumber(uint64_t sequence_number);
+//====== Duplicates: ================================
+    // Documents are duplicates if their sets of distinct words (without stop words) are equal.
+    // Each set is hashed into a 64-bit fingerprint when the document is added, duplicates are
+    // found as equal fingerprints in a hash table, so a pass is linear in the number of documents.
+    // Of every group of duplicates, the document with the lowest id is kept.
+    uint64_t GetWordSetFingerprint(int document_id) const;
+    //ids of all documents but the lowest one of each group, sorted
+    std::vector<int> FindDuplicateDocumentIds() const;
+    // If enabled, AddDocument drops a document duplicating a stored one with a lower id,
+    // and removes a stored duplicate with a higher id. Dropped ids are returned by
+    // TakeDroppedDuplicateIds. Enable before adding documents, or run RemoveDuplicates first.
+    void SetDuplicateDetection(bool enabled);
+    std::vector<int> TakeDroppedDuplicateIds();
+//====== Index Segments: ============================
+    // New documents go to a small mutable segment, which is frozen into an immutable
+    // IndexSegment once it holds mutable_segment_limit documents. Frozen segments are merged
+    // by size tier: SEGMENT_MERGE_FACTOR segments of one tier are merged into one segment.
+    // Removed documents stay in frozen segments as tombstones until their segment is merged.
+    struct SegmentMergePlan {
+        std::vector<std::shared_ptr<const IndexSegment>> segments;
+        std::set<int> removed_document_ids;
+        TermFreqPrecision precision = TermFreqPrecision::DOUBLE;
+    };
+    void SetMutableSegmentLimit(size_t max_documents);
+    // Applies to segments frozen or merged afterwards; relevance is accumulated in float
+    // for every precision but DOUBLE. The mutable segment always keeps exact values.
+    void SetTermFreqPrecision(TermFreqPrecision precision);
+    //freezes the mutable segment and re-encodes everything into one segment
+    void RebuildSegments();
+    //if disabled, merging is left to the owner (e.g. a background thread)
+    void SetInlineSegmentMerging(bool enabled);
+    void FreezeMutableSegment();
+    size_t GetSegmentCount() const;
+    //returns a plan with no segments if no tier is full
+    SegmentMergePlan PlanSegmentMerge() const;
+    //does not touch the server, can run on any thread
+    static std::shared_ptr<const IndexSegment> ExecuteSegmentMerge(const SegmentMergePlan& plan);
+    //returns false if the planned segments are no longer in the index
+    bool ApplySegmentMerge(const SegmentMergePlan& plan, std::shared_ptr<const IndexSegment> merged_segment);
+    //merges until no tier is full
+    void MergeSegments();
+//====== Memory Statistics: =========================
+    // Walks the word lists once, frozen segments report their own sizes.
+    // Byte counts are estimates of heap usage including container node overhead.
+    IndexMemoryStats GetMemoryStats(size_t heaviest_terms_count = 10) const;
+//====== Wildcard Queries: ==========================
+    // Query words with '*' or '?' (e.g. cat*, c?t) are expanded into the indexed words they match,
+    // each scored as a separate plus word (or excluding documents, if used as a minus word).
+    // Expansion walks the sorted dictionaries from the part before the first wildcard and keeps
+    // the first max_expansions matching words in sorted order. Minus words are not capped,
+    // they exclude documents with any matching word.
+    // The cap limits matches, not the walk: a pattern starting with a wildcard (*at) has no prefix
+    // and visits every word of every segment, O(vocabulary * segments) per query resolution.
+    void SetMaxWordExpansions(size_t max_expansions);
+//====== Typo-Tolerant Matching: ====================
+    // Opt-in: builds a deletion index over the vocabulary, which is then updated by AddDocument.
+    // A plus word found in no document is replaced by the indexed words closest to it
+    // (within max_edit_distance), scored with relevance multiplied by relevance_penalty per edit.
+    // Minus words are never corrected.
+    void EnableFuzzyMatching(int max_edit_distance = MAX_FUZZY_EDIT_DISTANCE,
+                             double relevance_penalty = DEFAULT_FUZZY_RELEVANCE_PENALTY);
+    void DisableFuzzyMatching();
+//====== Positional Index: ==========================
+    // Stores the positions of every word in every document, delta- and varint-encoded next to
+    // the postings. Enables "quoted phrases" (stop words inside keep their place, so "curly and dog"
+    // also matches "curly with dog") and NEAR/k between two words (a NEAR/3 b: at most 3 positions
+    // apart, in any order). Phrase and NEAR words are scored as plus words; a document must
+    // contain every phrase and satisfy every NEAR/k. Positions are decoded only for documents
+    // containing all words of a constraint. Without the index, quotes and NEAR/k are parsed
+    // as parts of ordinary words.
+    void EnablePositionalIndex();
+    bool HasPositionalIndex() const;
+//====== Tiered Posting Storage: ====================
+    // Postings of frozen segments are kept in two tiers: hot words in memory, cold words in a
+    // memory-mapped file per segment, created in directory and unlinked at once (it is freed with
+    // the last server copy using the segment). Segments count lookups of their words.
+    // RebalanceTiers keeps the most looked-up words in memory, smaller postings first on ties,
+    // up to max_resident_bytes of postings (document ids, term frequencies & positions), moves
+    // the rest to the cold tier and halves the counters, so words no longer queried get demoted.
+    // It runs on its own when a frozen or merged segment pushes the hot tier over the limit;
+    // promotions only happen when it is called. The mutable segment always stays in memory.
+    void EnableTieredStorage(const std::string& directory, size_t max_resident_bytes);
+    //moves all postings back to memory
+    void DisableTieredStorage();
+    void RebalanceTiers();
+//====== Prepared Queries: ==========================
+    PreparedQuery Prepare(const std::string& raw_query) const;
+    bool IsUpToDate(const PreparedQuery& query) const;
+    //looks postings up again if the query is not up to date; returns false if it had to
+    bool Refresh(PreparedQuery& query) const;
 //====== Find Top Documents: ========================
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
 //====== Match Document: ============================
     std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
     
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        uint64_t word_set_fingerprint;
     };
-    std::set<std::string> stop_words_;
+    StopWordSet stop_words_;
+    //mutable segment:
     std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
+    std::map<std::string, std::map<int, std::string>> word_to_document_positions_; //if positional_index_
+    //distinct words of every document in the mutable segment, its postings are erased on removal
+    std::map<int, std::vector<std::string>> mutable_segment_document_words_;
+    //frozen segments & tombstones:
+    std::vector<std::shared_ptr<const IndexSegment>> segments_;
+    std::set<int> removed_document_ids_;
+    size_t mutable_segment_limit_ = DEFAULT_MUTABLE_SEGMENT_LIMIT;
+    TermFreqPrecision term_freq_precision_ = TermFreqPrecision::DOUBLE;
+    bool inline_segment_merging_ = true;
+    bool positional_index_ = false;
+    std::string cold_storage_directory_;        //tiered storage is enabled if not empty
+    size_t max_resident_posting_bytes_ = 0;
+    size_t max_word_expansions_ = DEFAULT_MAX_WORD_EXPANSIONS;
+    //copies of the server share its frozen chunks, only set if fuzzy matching is enabled
+    std::optional<DeletionIndex> deletion_index_;
+    double fuzzy_relevance_penalty_ = DEFAULT_FUZZY_RELEVANCE_PENALTY;
+    std::shared_ptr<WriteAheadLog> write_ahead_log_;
+    uint64_t log_sequence_number_ = 0;
+    //persistent, so copies of the server share the document table
+    PersistentMap<int, DocumentData> documents_;
+    bool duplicate_detection_ = false;
+    PersistentMap<uint64_t, int> fingerprint_to_document_id_; //only filled if detection is enabled
+    std::vector<int> dropped_duplicate_ids_;
+    //changes on every modification, copy and move, unique among all servers;
+    //new members must be added to the copy & move constructors and assignments
+    uint64_t index_version_ = NextIndexVersion();
+    
+    static uint64_t NextIndexVersion();
+    void MarkIndexChanged();
+    void RebalanceTiersIfOverLimit();
+    std::string MakeColdFilePath() const;
     
     static inline int ComputeAverageRating(const std::vector<int>& ratings);
-    bool IsStopWord(const std::string& word) const;
+    static uint64_t ComputeWordSetFingerprint(const std::vector<std::string>& words);
+    bool IsStopWord(std::string_view word) const;
+    bool IsRemoved(int document_id) const;
+    //drops tombstones of documents no longer stored in any segment
+    void PurgeRemovedDocumentIds();
     std::vector<std::string> ParseStringInput(const std::string& text) const;
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    //positions, if given, receive the position of each word among all words of the text
+    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text, std::vector<uint32_t>* positions = nullptr) const;
+    //document_id must be non-negative, words are the document without stop words
+    //and positions are filled if the positional index is enabled
+    void AddSplitDocument(int document_id, const std::string& document, const std::vector<std::string>& words,
+                          const std::vector<uint32_t>& positions, DocumentStatus status, const std::vector<int>& ratings);
+    // RemoveDocument without logging, the document must exist. Postings in the mutable segment
+    // are erased right away, postings in frozen segments are hidden by a tombstone
+    void EraseDocument(int document_id);
+    //calls handler(document_id, term_freq) for every live posting of the word in all segments
+    template <typename Score, typename PostingHandler>
+    void ForEachPosting(const PreparedQuery::ResolvedWord& word, PostingHandler handler) const;
+    //calls handler(word, posting_count) for distinct words with the prefix in sorted order,
+    //posting_count includes postings of removed documents; stops when handler returns false
+    template <typename WordHandler>
+    void ForEachIndexedWord(std::string_view prefix, WordHandler handler) const;
+    //replaces wildcard patterns with at most max_expansions indexed words each
+    std::set<std::string> ExpandQueryWords(const std::vector<std::string>& query_words, size_t max_expansions) const;
+    PreparedQuery::ResolvedWord ResolveWord(const std::string& word) const;
+    //closest indexed words with postings, relevance penalty applied
+    std::vector<PreparedQuery::ResolvedWord> ResolveCorrections(const std::string& word) const;
+    void ResolvePreparedQuery(PreparedQuery& query) const;
+    // Existence required: documents_with_word > 0
+    double ComputeInverseDocumentFreq(int documents_with_word) const;
     
     struct QueryWord {
         std::string data;
@@ -75,12 +326,17 @@ private:
     struct Query {
         std::set<std::string> plus_words;
         std::set<std::string> minus_words;
+        std::vector<PreparedQuery::PositionalConstraint> positional_constraints;
     };
     
     Query ParseQuery(const std::string& text) const;
+    bool MatchesPositionalConstraints(const PreparedQuery& query, int document_id) const;
     
+    // Query must be up to date
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+    template <typename Score, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsWithScore(const PreparedQuery& query, DocumentPredicate document_predicate) const;
 };
 
 
@@ -89,6 +345,10 @@ template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
 : stop_words_(ParseStopWords(stop_words)) {}
 
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWordSet<N>& stop_words)
+: stop_words_(stop_words) {}
+
 template<typename StringContainer>
 std::set<std::string> SearchServer::ParseStopWords(const StringContainer& stop_words)  {
     std::set<std::string> unique_words = MakeUniqueNonEmptyStrings(stop_words);
@@ -101,10 +361,22 @@ std::set<std::string> SearchServer::ParseStopWords(const StringContainer& stop_w
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
+    TRACE_SPAN("FindTopDocuments");
+    return FindTopDocuments(Prepare(raw_query), document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    TRACE_SPAN("FindPrepared");
+    if (!IsUpToDate(query)) {
+        PreparedQuery refreshed_query = query;
+        ResolvePreparedQuery(refreshed_query);
+        return FindTopDocuments(refreshed_query, document_predicate);
+    }
     
     auto matched_documents = FindAllDocuments(query, document_predicate);
     
+    TRACE_SPAN("SortResults");
     std::sort(matched_documents.begin(), matched_documents.end(),
               [](const Document& lhs, const Document& rhs) {
         if (std::abs(lhs.relevance - rhs.relevance) < PRECISION_EPSILON) {
@@ -120,34 +392,113 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_quer
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    
-    std::map<int, double> document_to_relevance;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+std::vector<Document> SearchServer::FindAllDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    if (term_freq_precision_ == TermFreqPrecision::DOUBLE) {
+        return FindAllDocumentsWithScore<double>(query, document_predicate);
+    }
+    return FindAllDocumentsWithScore<float>(query, document_predicate);
+}
+
+template <typename Score, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocumentsWithScore(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    TRACE_ONLY(int64_t postings_touched = 0;)
+    TRACE_ONLY(int64_t predicate_calls = 0;)
+    const DocumentIdSet& excluded_documents = query.excluded_documents_;
+    std::map<int, Score> document_to_relevance;
+    {
+        TRACE_SPAN("ScorePlusWords");
+        for (const auto& word : query.resolved_plus_words_) {
+            if (word.documents_with_word == 0) {
+                continue;
             }
+            const Score inverse_document_freq = static_cast<Score>(word.inverse_document_freq);
+            ForEachPosting<Score>(word, [&](int document_id, Score term_freq) {
+                TRACE_ONLY(++postings_touched;)
+                //excluded documents are skipped before the predicate is called
+                if (!excluded_documents.Empty() && excluded_documents.Contains(document_id)) {
+                    return;
+                }
+                TRACE_ONLY(++predicate_calls;)
+                const auto& document_data = documents_.At(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                }
+            });
         }
     }
-    
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+    TRACE_COUNTER("candidates_scored", document_to_relevance.size());
+    if (!query.positional_constraints_.empty()) {
+        TRACE_SPAN("CheckPositions");
+        for (auto it = document_to_relevance.begin(); it != document_to_relevance.end(); ) {
+            it = MatchesPositionalConstraints(query, it->first) ? std::next(it) : document_to_relevance.erase(it);
         }
     }
+    TRACE_COUNTER("postings_touched", postings_touched);
+    TRACE_COUNTER("predicate_calls", predicate_calls);
     
     std::vector<Document> matched_documents;
     for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        matched_documents.push_back({document_id, relevance, documents_.At(document_id).rating});
     }
     return matched_documents;
 }
+
+template <typename Score, typename PostingHandler>
+void SearchServer::ForEachPosting(const PreparedQuery::ResolvedWord& word, PostingHandler handler) const {
+    if (word.mutable_postings != nullptr) {
+        for (const auto& [document_id, term_freq] : *word.mutable_postings) {
+            if (!IsRemoved(document_id)) {
+                handler(document_id, static_cast<Score>(term_freq));
+            }
+        }
+    }
+    for (const PostingList& postings : word.segment_postings) {
+        for (size_t i = 0; i < postings.size; ++i) {
+            if (!IsRemoved(postings.document_ids[i])) {
+                handler(postings.document_ids[i], postings.GetTermFreq<Score>(i));
+            }
+        }
+    }
+}
+
+template <typename WordHandler>
+void SearchServer::ForEachIndexedWord(std::string_view prefix, WordHandler handler) const {
+    auto mutable_it = word_to_document_freqs_.lower_bound(std::string(prefix));
+    std::vector<size_t> cursors;
+    cursors.reserve(segments_.size());
+    for (const auto& segment : segments_) {
+        cursors.push_back(segment->LowerBound(prefix));
+    }
+    while (true) {
+        //smallest word with the prefix among all segments
+        std::optional<std::string_view> min_word;
+        if (mutable_it != word_to_document_freqs_.end() && mutable_it->first.starts_with(prefix)) {
+            min_word = mutable_it->first;
+        }
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            if (cursors[i] < segments_[i]->GetWordCount()) {
+                const std::string_view word = segments_[i]->GetWord(cursors[i]);
+                if (word.starts_with(prefix) && (!min_word || word < *min_word)) {
+                    min_word = word;
+                }
+            }
+        }
+        if (!min_word) {
+            return;
+        }
+        size_t posting_count = 0;
+        if (mutable_it != word_to_document_freqs_.end() && mutable_it->first == *min_word) {
+            posting_count += mutable_it->second.size();
+            ++mutable_it;
+        }
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            if (cursors[i] < segments_[i]->GetWordCount() && segments_[i]->GetWord(cursors[i]) == *min_word) {
+                posting_count += segments_[i]->GetPostings(cursors[i]).size;
+                ++cursors[i];
+            }
+        }
+        if (!handler(*min_word, posting_count)) {
+            return;
+        }
+    }
+}
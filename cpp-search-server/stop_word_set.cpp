@@ -0,0 +1,48 @@
+#include "stop_word_set.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+//**************** Class Stop Word Set ****************//
+StopWordSet::StopWordSet(const std::set<string>& words)
+: size_(words.size()) {
+    if (words.empty()) {
+        return;
+    }
+    const vector<string_view> word_views(words.begin(), words.end());
+    vector<uint64_t> word_hashes;
+    word_hashes.reserve(size_);
+    for (const string_view word : word_views) {
+        word_hashes.push_back(HashStopWord(word));
+    }
+    displacements_.resize(GetStopWordBucketCount(size_));
+    vector<size_t> slot_words(GetStopWordSlotCount(size_));
+    vector<size_t> scratch(GetStopWordScratchSize(size_));
+    while (!BuildStopWordHash(word_views.data(), word_hashes.data(), size_, seed_, displacements_.data(),
+                              slot_words.data(), scratch.data())) {
+        ++seed_;
+    }
+    for (const size_t word_index : slot_words) {
+        AppendSlotWord(word_index < size_ ? word_views[word_index] : string_view());
+    }
+    words_data_.shrink_to_fit();
+}
+
+size_t StopWordSet::GetSize() const {
+    return size_;
+}
+
+size_t StopWordSet::GetMemoryBytes() const {
+    return words_data_.capacity()
+        + displacements_.capacity() * sizeof(StopWordDisplacement)
+        + word_offsets_.capacity() * sizeof(uint32_t);
+}
+
+//============== Private Methods ==============
+void StopWordSet::AppendSlotWord(string_view word) {
+    words_data_.append(word);
+    word_offsets_.push_back(static_cast<uint32_t>(words_data_.size()));
+}
+
+//************* End of Class Stop Word Set *************//
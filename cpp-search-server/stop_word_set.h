@@ -0,0 +1,344 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const std::string STOP_WORD_INVALID_SYMBOLS_MSG = "StopWordSet ERROR: Invalid symbols in stop word";
+
+// Stop words are kept in a perfect hash table (hash and displace): a word hashes to a bucket,
+// the bucket's displacement moves its words to distinct free slots. The table has half again
+// as many slots as words, so that a displacement is found in a few tries even for the last
+// buckets, and the compile-time build fits into the default constexpr limits of the compilers.
+// A lookup is one hash of the word, two array reads and one comparison, without allocations.
+struct StopWordDisplacement {
+    uint32_t multiplier = 0;
+    uint32_t offset = 0;
+};
+
+// FNV-1a of the word, independent of the seed, so that a word is hashed once however many
+// seeds are tried. Control characters (invalid in stop words) are reported on the way,
+// so the compile-time table checks and hashes its words in one pass.
+constexpr uint64_t HashStopWord(std::string_view word, bool& has_control_chars) {
+    uint64_t hash = 14695981039346656037ull;
+    //indexed instead of a range-for, which costs compile-time evaluation steps
+    const char* data = word.data();
+    const size_t size = word.size();
+    for (size_t i = 0; i < size; ++i) {
+        const uint8_t c = static_cast<uint8_t>(data[i]);
+        has_control_chars = has_control_chars || c <= 31;
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t HashStopWord(std::string_view word) {
+    bool has_control_chars = false;
+    return HashStopWord(word, has_control_chars);
+}
+
+//murmur finalizer of the word hash combined with the seed
+constexpr uint64_t MixStopWordHash(uint64_t word_hash, uint64_t seed) {
+    uint64_t hash = word_hash ^ (seed * 0x9e3779b97f4a7c15ull);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+constexpr size_t GetStopWordBucket(uint64_t hash, size_t bucket_count) {
+    //multiply-shift instead of a division
+    return static_cast<size_t>(((hash >> 32) * bucket_count) >> 32);
+}
+
+constexpr uint64_t GetStopWordFirstHash(uint64_t hash) {
+    return hash & 0xffffffffull;
+}
+
+constexpr uint64_t GetStopWordSecondHash(uint64_t hash) {
+    return (hash * 0xc2b2ae3d27d4eb4full) >> 32;
+}
+
+constexpr size_t GetStopWordSlot(uint64_t hash, StopWordDisplacement displacement, size_t slot_count) {
+    return static_cast<size_t>((GetStopWordFirstHash(hash) + displacement.multiplier * GetStopWordSecondHash(hash)
+                                + displacement.offset) % slot_count);
+}
+
+constexpr size_t GetStopWordBucketCount(size_t word_count) {
+    return std::max<size_t>((word_count + 1) / 2, 1);
+}
+
+constexpr size_t GetStopWordSlotCount(size_t word_count) {
+    return word_count + word_count / 2 + 1;
+}
+
+constexpr size_t GetStopWordScratchSize(size_t word_count) {
+    return 6 * word_count + 2 * GetStopWordBucketCount(word_count) + GetStopWordSlotCount(word_count) + 3;
+}
+
+// Finds a displacement for every bucket, largest buckets first.
+// word_hashes are HashStopWord(words[i]). Repeated words are placed once: they hash to the same
+// bucket and are dropped there, so the words need not be sorted (sorting hundreds of strings
+// alone exceeds the constexpr limits).
+// slot_words receives the index of the word in each of GetStopWordSlotCount(count) slots,
+// count for an empty slot;
+// displacements needs GetStopWordBucketCount(count) elements, scratch GetStopWordScratchSize(count).
+// Returns false if the seed leaves a bucket without a displacement.
+constexpr bool BuildStopWordHash(const std::string_view* words, const uint64_t* word_hashes, size_t count, uint64_t seed,
+                                 StopWordDisplacement* displacements, size_t* slot_words, size_t* scratch) {
+    constexpr uint32_t MAX_MULTIPLIER = 64;
+    const size_t bucket_count = GetStopWordBucketCount(count);
+    const size_t slot_count = GetStopWordSlotCount(count);
+    size_t* first_hashes = scratch;                         //count, reduced modulo slot_count
+    size_t* second_hashes = first_hashes + count;           //count, reduced modulo slot_count
+    size_t* word_buckets = second_hashes + count;           //count
+    size_t* words_by_bucket = word_buckets + count;         //count
+    size_t* bucket_begin = words_by_bucket + count;         //bucket_count + 1
+    size_t* bucket_order = bucket_begin + bucket_count + 1; //bucket_count
+    size_t* size_begin = bucket_order + bucket_count;       //count + 2
+    size_t* bucket_slots = size_begin + count + 2;          //count
+    size_t* slot_tries = bucket_slots + count;              //slot_count, the last try that took the slot
+    for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+        bucket_begin[bucket] = 0;
+    }
+    for (size_t size = 0; size < count + 2; ++size) {
+        size_begin[size] = 0;
+    }
+    for (size_t slot = 0; slot < slot_count; ++slot) {
+        slot_words[slot] = count;
+        slot_tries[slot] = 0;
+    }
+    //counting sort of the words by bucket
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t hash = MixStopWordHash(word_hashes[i], seed);
+        first_hashes[i] = static_cast<size_t>(GetStopWordFirstHash(hash) % slot_count);
+        second_hashes[i] = static_cast<size_t>(GetStopWordSecondHash(hash) % slot_count);
+        word_buckets[i] = GetStopWordBucket(hash, bucket_count);
+        ++bucket_begin[word_buckets[i] + 1];
+    }
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bucket_begin[bucket + 1] += bucket_begin[bucket];
+        bucket_order[bucket] = bucket_begin[bucket];        //fill cursor
+    }
+    for (size_t i = 0; i < count; ++i) {
+        words_by_bucket[bucket_order[word_buckets[i]]++] = i;
+    }
+    //counting sort of the buckets by decreasing size
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        ++size_begin[count - (bucket_begin[bucket + 1] - bucket_begin[bucket]) + 1];
+    }
+    for (size_t size = 0; size <= count; ++size) {
+        size_begin[size + 1] += size_begin[size];
+    }
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bucket_order[size_begin[count - (bucket_begin[bucket + 1] - bucket_begin[bucket])]++] = bucket;
+    }
+    
+    size_t try_number = 0;
+    for (size_t order = 0; order < bucket_count; ++order) {
+        const size_t bucket = bucket_order[order];
+        size_t* bucket_words = words_by_bucket + bucket_begin[bucket];
+        size_t bucket_size = bucket_begin[bucket + 1] - bucket_begin[bucket];
+        if (bucket_size == 0) {
+            break;
+        }
+        for (size_t i = 1; i < bucket_size; ) {
+            const size_t word = bucket_words[i];
+            bool is_repeated = false;
+            for (size_t j = 0; j < i && !is_repeated; ++j) {
+                const size_t other = bucket_words[j];
+                is_repeated = word_hashes[word] == word_hashes[other] && words[word] == words[other];
+            }
+            if (is_repeated) {
+                bucket_words[i] = bucket_words[--bucket_size];
+            } else {
+                ++i;
+            }
+        }
+        bool is_placed = false;
+        for (uint32_t multiplier = 0; multiplier < MAX_MULTIPLIER && !is_placed; ++multiplier) {
+            //slots of the bucket's words for offset 0, an offset then costs one addition per word
+            for (size_t i = 0; i < bucket_size; ++i) {
+                const size_t word = bucket_words[i];
+                bucket_slots[i] = (first_hashes[word] + multiplier * second_hashes[word]) % slot_count;
+            }
+            size_t offset = 0;
+            size_t first_slot = bucket_slots[0];
+            while (offset < slot_count && !is_placed) {
+                //skips offsets that put the first word on a taken slot, the table is never full
+                if (slot_words[first_slot] != count) {
+                    ++offset;
+                    first_slot = first_slot + 1 < slot_count ? first_slot + 1 : 0;
+                    continue;
+                }
+                //the other slots must be free and differ from the slots taken in this try
+                ++try_number;
+                slot_tries[first_slot] = try_number;
+                size_t placed_count = 1;
+                while (placed_count < bucket_size) {
+                    size_t slot = bucket_slots[placed_count] + offset;
+                    slot = slot < slot_count ? slot : slot - slot_count;
+                    if (slot_words[slot] != count || slot_tries[slot] == try_number) {
+                        break;
+                    }
+                    slot_tries[slot] = try_number;
+                    ++placed_count;
+                }
+                if (placed_count == bucket_size) {
+                    is_placed = true;
+                    displacements[bucket] = {multiplier, static_cast<uint32_t>(offset)};
+                    for (size_t i = 0; i < bucket_size; ++i) {
+                        const size_t slot = bucket_slots[i] + offset;
+                        slot_words[slot < slot_count ? slot : slot - slot_count] = bucket_words[i];
+                    }
+                } else {
+                    ++offset;
+                    first_slot = first_slot + 1 < slot_count ? first_slot + 1 : 0;
+                }
+            }
+        }
+        if (!is_placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//**************** Class Static Stop Word Set ****************//
+// Stop word table built at compile time:
+//     static constexpr StaticStopWordSet STOP_WORDS(std::array{"and"sv, "in"sv, "on"sv});
+// Invalid words fail compilation. Empty and repeated words are ignored.
+// Several hundred words fit into the default constexpr limits of GCC and Clang.
+template <size_t N>
+class StaticStopWordSet {
+public:
+    constexpr explicit StaticStopWordSet(std::array<std::string_view, N> words);
+
+    constexpr bool Contains(std::string_view word) const;
+    constexpr size_t GetSize() const;
+
+private:
+    friend class StopWordSet;
+    size_t size_ = 0;
+    uint64_t seed_ = 0;
+    size_t bucket_count_ = 1;
+    size_t slot_count_ = 1;
+    std::array<StopWordDisplacement, GetStopWordBucketCount(N)> displacements_{};
+    std::array<std::string_view, GetStopWordSlotCount(N)> slots_{}; //empty views in empty slots
+};
+
+//**************** Class Stop Word Set ****************//
+class StopWordSet {
+public:
+    StopWordSet() = default;
+    //words must be non-empty and valid
+    explicit StopWordSet(const std::set<std::string>& words);
+    template <size_t N>
+    explicit StopWordSet(const StaticStopWordSet<N>& words);
+
+    bool Contains(std::string_view word) const;
+    size_t GetSize() const;
+    size_t GetMemoryBytes() const;
+
+private:
+    size_t size_ = 0;
+    uint64_t seed_ = 0;
+    std::vector<StopWordDisplacement> displacements_;
+    std::string words_data_;
+    //word in slot i is words_data_[word_offsets_[i], word_offsets_[i + 1]), empty slots are empty
+    std::vector<uint32_t> word_offsets_{0};
+
+    std::string_view GetSlotWord(size_t slot) const;
+    void AppendSlotWord(std::string_view word);
+};
+
+//====== Template & Inline Definitions: ===============
+template <size_t N>
+constexpr StaticStopWordSet<N>::StaticStopWordSet(std::array<std::string_view, N> words) {
+    //raw pointers instead of std::array::operator[], every call counts against the constexpr limits
+    //empty words are skipped, repeated ones are dropped by BuildStopWordHash
+    std::array<std::string_view, N> stop_words{};
+    std::array<uint64_t, N> word_hashes{};
+    const std::string_view* input_words = words.data();
+    std::string_view* kept_words = stop_words.data();
+    uint64_t* kept_hashes = word_hashes.data();
+    size_t word_count = 0;
+    for (size_t i = 0; i < N; ++i) {
+        bool has_control_chars = false;
+        const uint64_t word_hash = HashStopWord(input_words[i], has_control_chars);
+        if (has_control_chars) {
+            throw std::invalid_argument(STOP_WORD_INVALID_SYMBOLS_MSG);
+        }
+        if (!input_words[i].empty()) {
+            kept_words[word_count] = input_words[i];
+            kept_hashes[word_count] = word_hash;
+            ++word_count;
+        }
+    }
+    if (word_count == 0) {
+        return;
+    }
+    bucket_count_ = GetStopWordBucketCount(word_count);
+    slot_count_ = GetStopWordSlotCount(word_count);
+    std::array<size_t, GetStopWordSlotCount(N)> slot_words{};
+    std::array<size_t, GetStopWordScratchSize(N)> scratch{};
+    while (!BuildStopWordHash(kept_words, kept_hashes, word_count, seed_, displacements_.data(),
+                              slot_words.data(), scratch.data())) {
+        ++seed_;
+    }
+    //empty slots are assigned too, GCC rejects reading array elements only value-initialized in a constant
+    const size_t* slot_word_indexes = slot_words.data();
+    std::string_view* slots = slots_.data();
+    for (size_t slot = 0; slot < slot_count_; ++slot) {
+        if (slot_word_indexes[slot] < word_count) {
+            slots[slot] = kept_words[slot_word_indexes[slot]];
+            ++size_;
+        } else {
+            slots[slot] = std::string_view();
+        }
+    }
+}
+
+template <size_t N>
+constexpr bool StaticStopWordSet<N>::Contains(std::string_view word) const {
+    if (size_ == 0 || word.empty()) {
+        return false;
+    }
+    const uint64_t hash = MixStopWordHash(HashStopWord(word), seed_);
+    return slots_[GetStopWordSlot(hash, displacements_[GetStopWordBucket(hash, bucket_count_)], slot_count_)] == word;
+}
+
+template <size_t N>
+constexpr size_t StaticStopWordSet<N>::GetSize() const {
+    return size_;
+}
+
+template <size_t N>
+StopWordSet::StopWordSet(const StaticStopWordSet<N>& words)
+: size_(words.size_)
+, seed_(words.seed_) {
+    if (words.size_ == 0) {
+        return;
+    }
+    displacements_.assign(words.displacements_.begin(), words.displacements_.begin() + words.bucket_count_);
+    for (size_t slot = 0; slot < words.slot_count_; ++slot) {
+        AppendSlotWord(words.slots_[slot]);
+    }
+}
+
+inline bool StopWordSet::Contains(std::string_view word) const {
+    if (displacements_.empty() || word.empty()) {
+        return false;
+    }
+    const uint64_t hash = MixStopWordHash(HashStopWord(word), seed_);
+    const size_t bucket = GetStopWordBucket(hash, displacements_.size());
+    return GetSlotWord(GetStopWordSlot(hash, displacements_[bucket], word_offsets_.size() - 1)) == word;
+}
+
+inline std::string_view StopWordSet::GetSlotWord(size_t slot) const {
+    return std::string_view(words_data_).substr(word_offsets_[slot], word_offsets_[slot + 1] - word_offsets_[slot]);
+}
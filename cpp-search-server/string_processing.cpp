@@ -1,9 +1,46 @@
 #include "string_processing.h"
 
+#include <algorithm>
+
 using std::cout;
 using std::string;
+using std::string_view;
 using std::operator""s;
 
+bool IsWildcardPattern(string_view word) {
+    return word.find_first_of("*?") != string_view::npos;
+}
+
+bool MatchesWildcardPattern(string_view word, string_view pattern) {
+    //greedy matching, on mismatch the last '*' takes one more character
+    size_t word_pos = 0;
+    size_t pattern_pos = 0;
+    size_t star_pos = string_view::npos;
+    size_t star_word_pos = 0;
+    while (word_pos < word.size()) {
+        if (pattern_pos < pattern.size() && (pattern[pattern_pos] == '?' || pattern[pattern_pos] == word[word_pos])) {
+            ++word_pos;
+            ++pattern_pos;
+        } else if (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+            star_pos = pattern_pos++;
+            star_word_pos = word_pos;
+        } else if (star_pos != string_view::npos) {
+            pattern_pos = star_pos + 1;
+            word_pos = ++star_word_pos;
+        } else {
+            return false;
+        }
+    }
+    while (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+        ++pattern_pos;
+    }
+    return pattern_pos == pattern.size();
+}
+
+string_view GetWildcardPrefix(string_view pattern) {
+    return pattern.substr(0, std::min(pattern.find_first_of("*?"), pattern.size()));
+}
+
 void PrintMatchDocumentResult(int document_id, const std::vector<string>& words, DocumentStatus status) {
     cout << "{ "s
     << "document_id = "s << document_id << ", "s
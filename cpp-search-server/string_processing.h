@@ -2,6 +2,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "document.h"
@@ -17,6 +18,13 @@ std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings)
     return non_empty_strings;
 }
 
+//=================== Wildcards =======================//
+// '*' matches any sequence of characters (including none), '?' matches one character
+bool IsWildcardPattern(std::string_view word);
+bool MatchesWildcardPattern(std::string_view word, std::string_view pattern);
+//part of the pattern before the first wildcard
+std::string_view GetWildcardPrefix(std::string_view pattern);
+
 //=================== Print Range =====================//
 template <typename It>
 void PrintRange(It start, It finish) {
@@ -0,0 +1,150 @@
+#include "thread_pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using std::vector;
+
+namespace {
+
+//set on the worker threads
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+
+} // namespace
+
+//**************** Class Thread Pool ****************//
+ThreadPool::ThreadPool(ThreadPoolOptions options) {
+    const size_t thread_count = options.thread_count > 0
+        ? options.thread_count
+        : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&ThreadPool::RunWorker, this, i, options.pin_threads);
+    }
+}
+
+ThreadPool::ThreadPool(size_t thread_count)
+: ThreadPool(ThreadPoolOptions{thread_count, false}) {
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+ThreadPoolStats ThreadPool::GetStats() const {
+    ThreadPoolStats stats;
+    for (const auto& queue : queues_) {
+        std::lock_guard guard(queue->mutex);
+        stats.queue_depths.push_back(queue->tasks.size());
+    }
+    stats.submitted_tasks = submitted_tasks_.load(std::memory_order_relaxed);
+    stats.executed_tasks = executed_tasks_.load(std::memory_order_relaxed);
+    stats.stolen_tasks = stolen_tasks_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+//============== Private Methods ==============
+void ThreadPool::Push(Task task) {
+    size_t queue_index = GetCurrentWorkerIndex();
+    if (queue_index == queues_.size()) {
+        queue_index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    }
+    //counted first, so that the count never drops below the number of queued tasks
+    queued_tasks_.fetch_add(1);
+    submitted_tasks_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard guard(queues_[queue_index]->mutex);
+        queues_[queue_index]->tasks.push_back(std::move(task));
+    }
+    {
+        //taking the lock orders the notification after a sleeping worker's check
+        std::lock_guard guard(sleep_mutex_);
+    }
+    wakeup_.notify_one();
+}
+
+bool ThreadPool::TryRunTask() {
+    const size_t own_index = GetCurrentWorkerIndex();
+    Task task;
+    if (own_index < queues_.size()) {
+        WorkerQueue& own_queue = *queues_[own_index];
+        std::lock_guard guard(own_queue.mutex);
+        if (!own_queue.tasks.empty()) {
+            task = std::move(own_queue.tasks.back());
+            own_queue.tasks.pop_back();
+        }
+    }
+    if (!task) {
+        const size_t start = own_index < queues_.size() ? own_index + 1 : next_queue_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < queues_.size() && !task; ++i) {
+            WorkerQueue& queue = *queues_[(start + i) % queues_.size()];
+            std::lock_guard guard(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                if (own_index < queues_.size()) {
+                    stolen_tasks_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    queued_tasks_.fetch_sub(1);
+    task();
+    return true;
+}
+
+void ThreadPool::RunWorker(size_t worker_index, bool pin_thread) {
+    current_pool = this;
+    current_worker_index = worker_index;
+#ifdef __linux__
+    if (pin_thread) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(worker_index % std::max<size_t>(std::thread::hardware_concurrency(), 1), &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+#else
+    (void)pin_thread;
+#endif
+    while (true) {
+        if (TryRunTask()) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wakeup_.wait(lock, [this] { return stopping_ || queued_tasks_.load() > 0; });
+        if (stopping_ && queued_tasks_.load() == 0) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::GetCurrentWorkerIndex() const {
+    return current_pool == this ? current_worker_index : queues_.size();
+}
+
+//************* End of Class Thread Pool *************//
+
+ThreadPool& GetDefaultThreadPool() {
+    static ThreadPool thread_pool;
+    return thread_pool;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct ThreadPoolOptions {
+    size_t thread_count = 0;  //0 means std::thread::hardware_concurrency()
+    bool pin_threads = false; //worker i runs on CPU i modulo the CPU count, only on Linux
+};
+
+struct ThreadPoolStats {
+    std::vector<size_t> queue_depths; //tasks waiting in each worker's deque
+    uint64_t submitted_tasks = 0;
+    uint64_t executed_tasks = 0;      //finished, counted before the result is made ready
+    uint64_t stolen_tasks = 0;        //taken from the deque of another worker
+};
+
+//**************** Class Thread Pool ****************//
+// Work-stealing scheduler: every worker has its own deque. Tasks submitted from a worker
+// go to its own deque, other tasks are spread round-robin. A worker takes its newest task
+// first (the data is likely still in cache) and, when its deque is empty, steals the oldest
+// task of another worker. Threads waiting for a result run queued tasks meanwhile,
+// so tasks may wait for other tasks without deadlocking the pool.
+class ThreadPool {
+public:
+    explicit ThreadPool(ThreadPoolOptions options = {});
+    explicit ThreadPool(size_t thread_count);
+    //runs all queued tasks before joining the workers
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const;
+    ThreadPoolStats GetStats() const;
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function function);
+    //runs queued tasks on the calling thread until the result is ready, blocks if there are none
+    template <typename Result>
+    Result Wait(std::future<Result> future);
+    // Calls function(begin, end) for consecutive ranges covering [0, count) and returns
+    // when all calls have finished; the first exception thrown is rethrown
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+private:
+    static inline constexpr std::chrono::microseconds WAIT_POLL_INTERVAL{200};
+
+    using Task = std::function<void()>;
+    struct ExecutionCounter {
+        std::atomic<uint64_t>& executed_tasks;
+        ~ExecutionCounter() {
+            executed_tasks.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    struct WorkerQueue {
+        mutable std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wakeup_;
+    bool stopping_ = false;                 //guarded by sleep_mutex_
+    std::atomic<size_t> queued_tasks_ = 0;  //submitted and not yet taken by any thread
+    std::atomic<size_t> next_queue_ = 0;
+
+    std::atomic<uint64_t> submitted_tasks_ = 0;
+    std::atomic<uint64_t> executed_tasks_ = 0;
+    std::atomic<uint64_t> stolen_tasks_ = 0;
+
+    void Push(Task task);
+    //runs one task, own deque first; returns false if all deques were empty
+    bool TryRunTask();
+    void RunWorker(size_t worker_index, bool pin_thread);
+    //index of the calling thread among the workers of this pool, or queues_.size()
+    size_t GetCurrentWorkerIndex() const;
+};
+
+//shared by the library, created on first use with default options
+ThreadPool& GetDefaultThreadPool();
+
+//====== Template Definitions: ========================
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::Submit(Function function) {
+    //std::function needs a copyable callable, the packaged task is shared instead
+    //the task is counted as executed before its result is ready, also if it throws,
+    //so that a caller who has the result sees it in the stats
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(
+        [this, function = std::move(function)]() mutable {
+            const ExecutionCounter counter{executed_tasks_};
+            return function();
+        });
+    auto future = task->get_future();
+    Push([task] { (*task)(); });
+    return future;
+}
+
+template <typename Result>
+Result ThreadPool::Wait(std::future<Result> future) {
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!TryRunTask()) {
+            //nothing to run: block until the result is ready, checking now and then
+            //for new tasks it may depend on
+            future.wait_for(WAIT_POLL_INTERVAL);
+        }
+    }
+    return future.get();
+}
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+    //a few ranges per thread, so that stealing can even out uneven ranges
+    const size_t range_count = std::min(count, GetThreadCount() * 4);
+    if (range_count <= 1) {
+        if (count > 0) {
+            function(size_t{0}, count);
+        }
+        return;
+    }
+    const size_t range_size = (count + range_count - 1) / range_count;
+    std::vector<std::future<void>> results;
+    for (size_t begin = range_size; begin < count; begin += range_size) {
+        const size_t end = std::min(begin + range_size, count);
+        results.push_back(Submit([&function, begin, end] { function(begin, end); }));
+    }
+    std::exception_ptr first_exception;
+    try {
+        function(size_t{0}, range_size);
+    } catch (...) {
+        first_exception = std::current_exception();
+    }
+    //every range must finish before function goes out of scope
+    for (auto& result : results) {
+        try {
+            Wait(std::move(result));
+        } catch (...) {
+            if (!first_exception) {
+                first_exception = std::current_exception();
+            }
+        }
+    }
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
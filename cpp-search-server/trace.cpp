@@ -0,0 +1,152 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using std::operator""s;
+
+namespace {
+
+struct TraceEvent {
+    const char* name = nullptr;
+    char phase = 'X'; //'X' complete span, 'C' counter
+    int64_t timestamp_ns = 0;
+    int64_t duration_ns = 0;
+    int64_t value = 0;
+};
+
+//written by its own thread, read by DumpChromeTrace
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(TRACE_BUFFER_CAPACITY);
+    size_t next = 0;
+    size_t size = 0;
+    int thread_number = 0;
+
+    void Push(const TraceEvent& event) {
+        std::lock_guard guard(mutex);
+        events[next] = event;
+        next = (next + 1) % events.size();
+        size = std::min(size + 1, events.size());
+    }
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    //buffers outlive their threads so traces can be dumped later
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+};
+
+struct TraceThreadState {
+    int depth = 0;
+    bool is_sampled = false;
+    uint64_t trace_count = 0;
+    std::shared_ptr<TraceBuffer> buffer;
+};
+
+std::atomic<uint32_t> trace_sampling = DEFAULT_TRACE_SAMPLING;
+
+TraceRegistry& GetTraceRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+TraceThreadState& GetThreadState() {
+    thread_local TraceThreadState state;
+    return state;
+}
+
+TraceBuffer& GetThreadBuffer() {
+    TraceThreadState& state = GetThreadState();
+    if (!state.buffer) {
+        state.buffer = std::make_shared<TraceBuffer>();
+        TraceRegistry& registry = GetTraceRegistry();
+        std::lock_guard guard(registry.mutex);
+        state.buffer->thread_number = static_cast<int>(registry.buffers.size()) + 1;
+        registry.buffers.push_back(state.buffer);
+    }
+    return *state.buffer;
+}
+
+int64_t NowNs() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintMicroseconds(std::ostream& out, int64_t ns) {
+    out << ns / 1000 << '.' << (ns % 1000) / 100 << (ns % 100) / 10 << ns % 10;
+}
+
+} // namespace
+
+void SetTraceSampling(uint32_t every_nth) {
+    trace_sampling = every_nth;
+}
+
+void DumpChromeTrace(std::ostream& out) {
+    TraceRegistry& registry = GetTraceRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    out << "{\"traceEvents\":["s;
+    bool is_first = true;
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard buffer_guard(buffer->mutex);
+        const size_t capacity = buffer->events.size();
+        for (size_t i = 0; i < buffer->size; ++i) {
+            const TraceEvent& event = buffer->events[(buffer->next + capacity - buffer->size + i) % capacity];
+            out << (is_first ? ""s : ","s) << "\n{\"name\":\""s << event.name << "\",\"ph\":\""s << event.phase
+                << "\",\"pid\":1,\"tid\":"s << buffer->thread_number << ",\"ts\":"s;
+            PrintMicroseconds(out, event.timestamp_ns);
+            if (event.phase == 'X') {
+                out << ",\"dur\":"s;
+                PrintMicroseconds(out, event.duration_ns);
+            } else {
+                out << ",\"args\":{\"value\":"s << event.value << '}';
+            }
+            out << '}';
+            is_first = false;
+        }
+    }
+    out << "\n]}"s << std::endl;
+}
+
+void ClearTraces() {
+    TraceRegistry& registry = GetTraceRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard buffer_guard(buffer->mutex);
+        buffer->next = 0;
+        buffer->size = 0;
+    }
+}
+
+TraceSpan::TraceSpan(const char* name)
+: name_(name) {
+    TraceThreadState& state = GetThreadState();
+    if (state.depth == 0) {
+        const uint32_t every_nth = trace_sampling.load(std::memory_order_relaxed);
+        state.is_sampled = every_nth > 0 && state.trace_count++ % every_nth == 0;
+    }
+    ++state.depth;
+    is_recorded_ = state.is_sampled;
+    if (is_recorded_) {
+        begin_ns_ = NowNs();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    TraceThreadState& state = GetThreadState();
+    --state.depth;
+    if (is_recorded_) {
+        GetThreadBuffer().Push({name_, 'X', begin_ns_, NowNs() - begin_ns_, 0});
+    }
+}
+
+void RecordTraceCounter(const char* name, int64_t value) {
+    const TraceThreadState& state = GetThreadState();
+    if (state.depth > 0 && state.is_sampled) {
+        GetThreadBuffer().Push({name, 'C', NowNs(), 0, value});
+    }
+}
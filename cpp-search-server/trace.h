@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+//===== Query Tracing =================================
+// Spans and counters are recorded into per-thread ring buffers and can be dumped
+// in Chrome trace_event JSON format (chrome://tracing, Perfetto).
+// The TRACE_* macros compile to nothing unless SEARCH_SERVER_TRACING is defined.
+// It is set for the whole build (in the Debug configuration of the Xcode project), never
+// per file: the macros are used in inline templates of search_server.h, which must have
+// the same definition in every translation unit.
+// The outermost span on a thread starts a trace; only every n-th trace is recorded,
+// nested spans and counters follow the decision of the outermost span.
+
+#ifdef SEARCH_SERVER_TRACING
+#define TRACE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define TRACE_CONCAT(lhs, rhs) TRACE_CONCAT_IMPL(lhs, rhs)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_COUNTER(name, value) RecordTraceCounter((name), static_cast<int64_t>(value))
+#define TRACE_ONLY(...) __VA_ARGS__
+#else
+#define TRACE_SPAN(name)
+#define TRACE_COUNTER(name, value)
+#define TRACE_ONLY(...)
+#endif
+
+inline constexpr uint32_t DEFAULT_TRACE_SAMPLING = 100;
+inline constexpr size_t TRACE_BUFFER_CAPACITY = 4096;
+
+//records one trace out of every_nth, 0 disables recording
+void SetTraceSampling(uint32_t every_nth);
+//writes the recorded events of all threads, oldest first
+void DumpChromeTrace(std::ostream& out);
+void ClearTraces();
+
+class TraceSpan {
+public:
+    //name must be a string literal
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+private:
+    const char* name_;
+    bool is_recorded_;
+    int64_t begin_ns_ = 0;
+};
+
+//recorded only inside a sampled span
+void RecordTraceCounter(const char* name, int64_t value);
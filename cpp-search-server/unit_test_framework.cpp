@@ -1,5 +1,12 @@
 #include "unit_test_framework.h"
 
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
 using std::string;
 using std::vector;
 
@@ -349,6 +356,1228 @@ void TestErrorReporting() {
     }
 }
 
+void TestConcurrentSnapshotReads() {
+    SearchServer initial_server("in the"s);
+    initial_server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    ConcurrentSearchServer server(std::move(initial_server));
+    {//unpublished changes are invisible
+        server.AddDocument(2, "dog in the park"s, DocumentStatus::ACTUAL, {1, 2, 3});
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+        ASSERT_HINT(server.FindTopDocuments("dog"s).empty(), "Unpublished document must not be found"s);
+    }
+    {//a held snapshot keeps its version after publication
+        const auto old_snapshot = server.GetSnapshot();
+        ASSERT(server.Publish());
+        ASSERT(!server.Publish());
+        ASSERT_EQUAL(server.GetPublishedVersion(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1u);
+        ASSERT_EQUAL(old_snapshot->GetDocumentCount(), 1);
+        ASSERT(old_snapshot->FindTopDocuments("dog"s).empty());
+    }
+    {//readers running concurrently with a writer always see a consistent version
+        const int added_docs = 200;
+        std::atomic<bool> inconsistent = false;
+        std::thread writer([&server] {
+            for (int id = 3; id < 3 + added_docs; ++id) {
+                server.AddDocument(id, "dog number "s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+                if (id % 10 == 0) {
+                    server.Publish();
+                }
+            }
+            server.Publish();
+        });
+        vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&server, &inconsistent] {
+                for (int j = 0; j < 200; ++j) {
+                    const auto snapshot = server.GetSnapshot();
+                    const int count = snapshot->GetDocumentCount();
+                    const auto found_docs = snapshot->FindTopDocuments("dog"s, [](int, DocumentStatus, int) { return true; });
+                    //every document but the first contains "dog"
+                    if (found_docs.size() != std::min<size_t>(count - 1, SearchServer::MAX_RESULT_DOCUMENT_COUNT)) {
+                        inconsistent = true;
+                    }
+                }
+            });
+        }
+        writer.join();
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        ASSERT_HINT(!inconsistent, "Snapshot changed while being read"s);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2 + added_docs);
+    }
+}
+
+void TestIndexSegments() {
+    const vector<string> contents = {
+        "white cat and fashionable collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s,
+        "groomed starling eugene"s, "big cat nasty hair"s, "big dog cat vladislav"s,
+        "big dog hamster borya"s, "funny pet with curly hair"s, "funny pet and nasty rat"s,
+    };
+    SearchServer reference_server("and with"s);
+    SearchServer segmented_server("and with"s);
+    segmented_server.SetMutableSegmentLimit(2);
+    for (int id = 0; id < static_cast<int>(contents.size()); ++id) {
+        reference_server.AddDocument(id, contents[id], DocumentStatus::ACTUAL, {id});
+        segmented_server.AddDocument(id, contents[id], DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_HINT(segmented_server.GetSegmentCount() > 0, "Full mutable segment must be frozen"s);
+    ASSERT_HINT(segmented_server.GetSegmentCount() < SearchServer::SEGMENT_MERGE_FACTOR, "Full tiers must be merged inline"s);
+    
+    const vector<string> queries = {"cat"s, "big dog -hamster"s, "funny curly hair"s, "groomed -eyes"s};
+    auto check_same_results = [&](const string& hint) {
+        for (const string& query : queries) {
+            const auto expected = reference_server.FindTopDocuments(query);
+            const auto found_docs = segmented_server.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), hint);
+            for (size_t i = 0; i < std::min(found_docs.size(), expected.size()); ++i) {
+                ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, hint);
+                ASSERT_EQUAL_HINT(found_docs[i].relevance, expected[i].relevance, hint);
+            }
+            for (int number = 0; number < reference_server.GetDocumentCount(); ++number) {
+                const int id = reference_server.GetDocumentId(number);
+                ASSERT_HINT(std::get<0>(segmented_server.MatchDocument(query, id)) == std::get<0>(reference_server.MatchDocument(query, id)), hint);
+            }
+        }
+    };
+    check_same_results("Segmented index must return the same results"s);
+    {//removed documents are hidden by tombstones until compaction
+        reference_server.RemoveDocument(5);
+        segmented_server.RemoveDocument(5);
+        ASSERT_EQUAL(segmented_server.GetDocumentCount(), 8);
+        for (const Document& document : segmented_server.FindTopDocuments("big dog cat"s)) {
+            ASSERT_HINT(document.id != 5, "Removed document must not be found"s);
+        }
+        try {
+            segmented_server.AddDocument(5, "big dog"s, DocumentStatus::ACTUAL, {1});
+            ASSERT_HINT(false, "Removed id must not be reused before its segment is merged"s);
+        } catch (std::exception& ex) {
+            ASSERT_EQUAL(ex.what(), REMOVED_ID_PENDING_MSG);
+        }
+        try {
+            segmented_server.RemoveDocument(5);
+            ASSERT_HINT(false, "Removing a missing document must throw"s);
+        } catch (std::exception& ex) {
+            ASSERT_EQUAL(ex.what(), INVALID_ID_MSG);
+        }
+    }
+    {//a document only in the mutable segment is erased right away, its id can be reused
+        SearchServer server("and with"s);
+        server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "curly pet"s, DocumentStatus::ACTUAL, {2});
+        server.RemoveDocument(1);
+        ASSERT(!server.IsRemovalPending(1));
+        ASSERT(server.FindTopDocuments("funny"s).empty());
+        server.AddDocument(1, "big dog"s, DocumentStatus::ACTUAL, {3});
+        ASSERT(server.FindTopDocuments("funny"s).empty());
+        ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("pet"s).size(), 1u);
+        ASSERT_EQUAL(server.GetMemoryStats().vocabulary_size, 4u);
+    }
+    {//results do not depend on how documents are spread over segments
+        segmented_server.FreezeMutableSegment();
+        segmented_server.MergeSegments();
+        check_same_results("Results must not change after merging"s);
+        const auto stale_plan = SearchServer::SegmentMergePlan{{IndexSegment::Build({}, {})}, {}};
+        ASSERT_HINT(!segmented_server.ApplySegmentMerge(stale_plan, SearchServer::ExecuteSegmentMerge(stale_plan)),
+                    "Merge of segments not in the index must be rejected"s);
+    }
+    {//background merging publishes merged segments
+        SearchServer initial_server("and with"s);
+        initial_server.SetMutableSegmentLimit(1);
+        ConcurrentSearchServer server(std::move(initial_server));
+        server.StartBackgroundMerging(std::chrono::milliseconds(1));
+        for (int id = 0; id < static_cast<int>(contents.size()); ++id) {
+            server.AddDocument(id, contents[id], DocumentStatus::ACTUAL, {id});
+            server.Publish();
+        }
+        server.StopBackgroundMerging();
+        const auto snapshot = server.GetSnapshot();
+        ASSERT_EQUAL(snapshot->GetDocumentCount(), static_cast<int>(contents.size()));
+        ASSERT_EQUAL(snapshot->FindTopDocuments("cat"s).size(), 4u);
+    }
+}
+
+void TestTermFreqPrecision() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    server.AddDocument(4, "big dog cat vladislav"s, DocumentStatus::IRRELEVANT, {1, 3, 2});
+    server.AddDocument(5, "big dog hamster borya hamster"s, DocumentStatus::ACTUAL, {1, 1, 1});
+    const vector<string> queries = {"curly dog"s, "funny pet -rat"s, "nasty hair"s, "hamster"s, "big cat"s};
+    {
+        const auto report = CompareScorePrecision(server, TermFreqPrecision::FLOAT, queries);
+        ASSERT_EQUAL(report.query_count, 5);
+        ASSERT_EQUAL(report.identical_rankings, 5);
+        ASSERT_EQUAL(report.errors_above_epsilon, 0);
+    }
+    {
+        const auto report = CompareScorePrecision(server, TermFreqPrecision::IMPACT_16, queries);
+        ASSERT_EQUAL(report.identical_rankings, 5);
+        ASSERT_HINT(report.max_relevance_error < 1e-4, "16-bit impacts are too coarse"s);
+    }
+    {
+        const auto report = CompareScorePrecision(server, TermFreqPrecision::IMPACT_8, queries);
+        ASSERT_HINT(report.max_relevance_error < 1e-2, "8-bit impacts are too coarse"s);
+    }
+    {//reduced precision server keeps matching the same documents
+        SearchServer reduced_server = server;
+        reduced_server.SetTermFreqPrecision(TermFreqPrecision::IMPACT_8);
+        reduced_server.RebuildSegments();
+        ASSERT_EQUAL(reduced_server.GetSegmentCount(), 1u);
+        ASSERT_EQUAL(reduced_server.FindTopDocuments("big"s).size(), 2u);
+        ASSERT_EQUAL(std::get<0>(reduced_server.MatchDocument("curly hair"s, 2)).size(), 2u);
+    }
+}
+
+void TestMemoryStats() {
+    SearchServer server("and with"s);
+    server.SetMutableSegmentLimit(3);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    server.AddDocument(4, "big dog cat vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2});
+    server.AddDocument(5, "big dog hamster borya"s, DocumentStatus::ACTUAL, {1, 1, 1});
+    server.RemoveDocument(5); //in the mutable segment, its postings are erased
+    server.RemoveDocument(3); //in the frozen segment, its postings stay until a merge
+    
+    const auto stats = server.GetMemoryStats(2);
+    ASSERT_EQUAL(stats.stop_words.objects, 2u);
+    ASSERT_EQUAL(stats.segment_count, 1u);
+    ASSERT_EQUAL(stats.frozen_segments.objects, 12u);
+    ASSERT_EQUAL(stats.mutable_segment.objects, 4u);
+    ASSERT_EQUAL(stats.documents.objects, 3u);
+    ASSERT_EQUAL(stats.removed_documents.objects, 1u);
+    //funny pet nasty rat curly hair big cat dog vladislav
+    ASSERT_EQUAL(stats.vocabulary_size, 10u);
+    ASSERT_EQUAL(stats.posting_length_histogram.size(), 2u);
+    ASSERT_EQUAL(stats.posting_length_histogram[0], 4u);
+    ASSERT_EQUAL(stats.posting_length_histogram[1], 6u);
+    ASSERT_EQUAL(stats.heaviest_terms.size(), 2u);
+    ASSERT_EQUAL(stats.heaviest_terms[0].postings, 2u);
+    ASSERT_EQUAL(stats.heaviest_terms[1].postings, 2u);
+    ASSERT(stats.GetTotalBytes() > stats.frozen_segments.bytes);
+}
+
+void TestPreparedQueries() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::BANNED, {1, 2, 8});
+    
+    PreparedQuery query = server.Prepare("curly nasty hair -rat and"s);
+    ASSERT(server.IsUpToDate(query));
+    ASSERT_EQUAL(query.GetPlusWords().size(), 3u);
+    ASSERT_EQUAL(query.GetMinusWords().size(), 1u);
+    {//same results as the raw query
+        const auto expected = server.FindTopDocuments("curly nasty hair -rat and"s, DocumentStatus::BANNED);
+        const auto found_docs = server.FindTopDocuments(query, DocumentStatus::BANNED);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, expected[0].id);
+        ASSERT_EQUAL(found_docs[0].relevance, expected[0].relevance);
+        ASSERT(server.MatchDocument(query, 2) == server.MatchDocument("curly nasty hair -rat and"s, 2));
+        ASSERT(std::get<0>(server.MatchDocument(query, 1)).empty());
+    }
+    {//stale query is looked up again
+        server.AddDocument(4, "big dog with curly hair"s, DocumentStatus::ACTUAL, {1, 3, 2});
+        ASSERT(!server.IsUpToDate(query));
+        const auto found_docs = server.FindTopDocuments(query);
+        ASSERT_EQUAL(found_docs.size(), 2u);
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument(query, 4)).size(), 2u);
+        ASSERT(!server.Refresh(query));
+        ASSERT(server.Refresh(query));
+        server.RemoveDocument(4);
+        ASSERT_EQUAL(server.FindTopDocuments(query).size(), 1u);
+    }
+    {//a query prepared by another server is valid for a copy
+        SearchServer copy = server;
+        ASSERT(!copy.IsUpToDate(query));
+        ASSERT_EQUAL(copy.FindTopDocuments(query).size(), 1u);
+    }
+    {//restoring a copy or moving into the server invalidates queries prepared against it
+        const SearchServer backup = server;
+        PreparedQuery curly_query = server.Prepare("curly"s);
+        server.AddDocument(5, "curly parrot"s, DocumentStatus::ACTUAL, {5});
+        server.FreezeMutableSegment();
+        ASSERT_EQUAL(server.FindTopDocuments(curly_query).size(), 2u);
+        server = backup;
+        ASSERT(!server.IsUpToDate(curly_query));
+        ASSERT_EQUAL(server.FindTopDocuments(curly_query).size(), 1u);
+        curly_query = server.Prepare("curly"s);
+        SearchServer moved = std::move(server);
+        ASSERT(!moved.IsUpToDate(curly_query));
+        server = std::move(moved);
+        ASSERT(!server.IsUpToDate(curly_query));
+        ASSERT_EQUAL(server.FindTopDocuments(curly_query).size(), 1u);
+    }
+    {//request queue accepts prepared queries
+        RequestQueue request_queue(server);
+        const PreparedQuery empty_query = server.Prepare("sparrow"s);
+        request_queue.AddFindRequest(empty_query);
+        request_queue.AddFindRequest(query, [](int, DocumentStatus, int rating) { return rating > 2; });
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+    }
+}
+
+void TestQueryTracing() {
+    auto count_occurrences = [](const string& text, const string& pattern) {
+        int count = 0;
+        for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1)) {
+            ++count;
+        }
+        return count;
+    };
+    ClearTraces();
+    {//every second trace is recorded, nested spans follow the outermost one
+        SetTraceSampling(2);
+        for (int i = 0; i < 4; ++i) {
+            TraceSpan query_span("TestQuery");
+            TraceSpan stage_span("TestStage");
+            RecordTraceCounter("test_counter", 42);
+        }
+        std::ostringstream out;
+        DumpChromeTrace(out);
+        const string trace = out.str();
+        ASSERT_EQUAL(trace.find("{\"traceEvents\":["s), 0u);
+        ASSERT_EQUAL(count_occurrences(trace, "\"name\":\"TestQuery\",\"ph\":\"X\""s), 2);
+        ASSERT_EQUAL(count_occurrences(trace, "\"name\":\"TestStage\""s), 2);
+        ASSERT_EQUAL(count_occurrences(trace, "\"args\":{\"value\":42}"s), 2);
+    }
+    ClearTraces();
+    {//disabled sampling records nothing
+        SetTraceSampling(0);
+        TraceSpan query_span("TestQuery");
+        std::ostringstream out;
+        DumpChromeTrace(out);
+        ASSERT_EQUAL(count_occurrences(out.str(), "TestQuery"s), 0);
+    }
+#ifdef SEARCH_SERVER_TRACING
+    {//search stages are traced when compiled in
+        SetTraceSampling(1);
+        SearchServer server("and with"s);
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        server.FindTopDocuments("funny -rat"s);
+        std::ostringstream out;
+        DumpChromeTrace(out);
+        const string trace = out.str();
+        for (const string& stage : {"AddDocument"s, "ParseQuery"s, "ScorePlusWords"s, "ExcludeMinusWords"s, "SortResults"s, "postings_touched"s}) {
+            ASSERT_EQUAL_HINT(count_occurrences(trace, "\""s + stage + "\""s), 1, stage);
+        }
+    }
+#endif
+    SetTraceSampling(DEFAULT_TRACE_SAMPLING);
+    ClearTraces();
+}
+
+void TestWriteAheadLog() {
+    const string log_path = (std::filesystem::temp_directory_path() / "search_server_wal_test.log"s).string();
+    std::filesystem::remove(log_path);
+    SearchServer server("and with"s);
+    SearchServer snapshot("and with"s);
+    {
+        server.SetWriteAheadLog(std::make_shared<WriteAheadLog>(log_path, false));
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        snapshot = server;
+        snapshot.SetWriteAheadLog(nullptr);
+        server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, {1, 2});
+        server.AddDocument(3, "nasty rat with curly tail"s, DocumentStatus::ACTUAL, {-3});
+        server.RemoveDocument(2);
+        try {//rejected changes are not logged
+            server.AddDocument(1, "duplicate id"s, DocumentStatus::ACTUAL, {});
+        } catch (const std::invalid_argument&) {
+        }
+        server.SetWriteAheadLog(nullptr);
+    }
+    {//replay restores the same documents, a torn record at the end is ignored
+        std::ofstream(log_path, std::ios::binary | std::ios::app) << "\x40\x00\x00\x00torn"s;
+        ThreadPool thread_pool(3);
+        const auto records = ReadWriteAheadLog(log_path, thread_pool);
+        ASSERT_EQUAL(records.size(), 4u);
+        ASSERT(records.back().kind == WalRecord::Kind::REMOVE_DOCUMENT);
+        ASSERT_EQUAL(records.back().sequence_number, 4u);
+        ASSERT_EQUAL(server.GetLogSequenceNumber(), 4u);
+        
+        SearchServer restored("and with"s);
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, restored, thread_pool), 4u);
+        ASSERT_EQUAL(restored.GetDocumentCount(), server.GetDocumentCount());
+        for (const string& query : {"funny rat"s, "curly -tail"s, "nasty"s}) {
+            const auto expected = server.FindTopDocuments(query);
+            const auto found = restored.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size() && i < expected.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+            }
+        }
+    }
+    {//replay on top of a snapshot applies only the records after it, replaying twice changes nothing
+        ASSERT_EQUAL(snapshot.GetLogSequenceNumber(), 1u);
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, snapshot), 3u);
+        ASSERT_EQUAL(snapshot.GetDocumentCount(), 2);
+        ASSERT_EQUAL(snapshot.GetLogSequenceNumber(), 4u);
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, snapshot), 0u);
+        ASSERT_EQUAL(snapshot.GetDocumentCount(), 2);
+    }
+    std::filesystem::remove(log_path);
+    {//a reused id is neither lost on a snapshot that has the new document nor on a full replay
+        SearchServer logged_server("and with"s);
+        logged_server.SetWriteAheadLog(std::make_shared<WriteAheadLog>(log_path, false));
+        logged_server.AddDocument(5, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        logged_server.RemoveDocument(5);
+        logged_server.RebuildSegments();
+        logged_server.AddDocument(5, "curly cat"s, DocumentStatus::ACTUAL, {2});
+        SearchServer reused_snapshot = logged_server;
+        reused_snapshot.SetWriteAheadLog(nullptr);
+        logged_server.SetWriteAheadLog(nullptr);
+        
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, reused_snapshot), 0u);
+        SearchServer restored("and with"s);
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, restored), 3u);
+        for (const SearchServer* replayed : {&reused_snapshot, &restored}) {
+            ASSERT_EQUAL(replayed->GetDocumentCount(), 1);
+            ASSERT_EQUAL(replayed->FindTopDocuments("curly"s).size(), 1u);
+            ASSERT(replayed->FindTopDocuments("funny"s).empty());
+        }
+    }
+    std::filesystem::remove(log_path);
+    {//a replaced duplicate is logged with its replacement, a failed append changes neither
+        SearchServer dedup_server("and with"s);
+        dedup_server.SetDuplicateDetection(true);
+        dedup_server.SetWriteAheadLog(std::make_shared<WriteAheadLog>(log_path, false));
+        dedup_server.AddDocument(5, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        dedup_server.AddDocument(3, "pet and funny"s, DocumentStatus::ACTUAL, {2});
+        dedup_server.SetWriteAheadLog(nullptr);
+        ASSERT(dedup_server.TakeDroppedDuplicateIds() == vector<int>{5});
+        const auto records = ReadWriteAheadLog(log_path);
+        ASSERT_EQUAL(records.size(), 2u);
+        ASSERT_EQUAL(records.back().replaced_document_id, 5);
+        //replayed the same way on a server without duplicate detection
+        SearchServer restored("and with"s);
+        ASSERT_EQUAL(ReplayWriteAheadLog(log_path, restored), 2u);
+        ASSERT_EQUAL(restored.GetDocumentCount(), 1);
+        ASSERT_EQUAL(restored.GetDocumentId(0), 3);
+        
+        std::filesystem::remove(log_path);
+        std::ofstream(log_path).close();
+        //writes to a read-only descriptor fail
+        dedup_server.SetWriteAheadLog(std::make_shared<WriteAheadLog>(open(log_path.c_str(), O_RDONLY), false));
+        bool thrown = false;
+        try {
+            dedup_server.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, {3});
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(dedup_server.GetDocumentCount(), 1);
+        ASSERT_EQUAL(dedup_server.GetDocumentId(0), 3);
+        ASSERT(dedup_server.TakeDroppedDuplicateIds().empty());
+        dedup_server.SetWriteAheadLog(nullptr);
+    }
+    std::filesystem::remove(log_path);
+    {//concurrent writers are group-committed
+        const int writer_count = 4;
+        const int documents_per_writer = 50;
+        auto log = std::make_shared<WriteAheadLog>(log_path, false);
+        ConcurrentSearchServer concurrent_server(SearchServer("and with"s));
+        concurrent_server.SetWriteAheadLog(log);
+        vector<std::thread> writers;
+        for (int writer = 0; writer < writer_count; ++writer) {
+            writers.emplace_back([&concurrent_server, writer] {
+                for (int i = 0; i < documents_per_writer; ++i) {
+                    concurrent_server.AddDocument(writer * documents_per_writer + i, "pet number "s + std::to_string(i), DocumentStatus::ACTUAL, {i});
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        ASSERT_EQUAL(log->GetRecordCount(), static_cast<uint64_t>(writer_count * documents_per_writer));
+        ASSERT(log->GetSyncCount() <= log->GetRecordCount());
+        //rejected changes are not logged
+        for (const auto& rejected_change : vector<std::function<void()>>{
+            [&concurrent_server] { concurrent_server.AddDocument(0, "existing id"s, DocumentStatus::ACTUAL, {}); },
+            [&concurrent_server] { concurrent_server.AddDocument(-1, "negative id"s, DocumentStatus::ACTUAL, {}); },
+            [&concurrent_server] { concurrent_server.RemoveDocument(1000); }}) {
+            try {
+                rejected_change();
+                ASSERT_HINT(false, "change must be rejected"s);
+            } catch (const std::invalid_argument&) {
+            }
+        }
+        ASSERT_EQUAL(log->GetRecordCount(), static_cast<uint64_t>(writer_count * documents_per_writer));
+        ASSERT(concurrent_server.Publish());
+        ASSERT_EQUAL(concurrent_server.GetSnapshot()->GetLogSequenceNumber(), static_cast<uint64_t>(writer_count * documents_per_writer));
+        
+        SearchServer restored("and with"s);
+        ReplayWriteAheadLog(log_path, restored);
+        ASSERT_EQUAL(restored.GetDocumentCount(), writer_count * documents_per_writer);
+    }
+    std::filesystem::remove(log_path);
+    {//a failed write fails every writer waiting for it and every later one
+        std::ofstream(log_path).close();
+        //writes to a read-only descriptor fail
+        auto log = std::make_shared<WriteAheadLog>(open(log_path.c_str(), O_RDONLY), false);
+        std::atomic<int> failed_appends = 0;
+        vector<std::thread> writers;
+        for (int writer = 0; writer < 4; ++writer) {
+            writers.emplace_back([&log, &failed_appends, writer] {
+                for (int i = 0; i < 10; ++i) {
+                    try {
+                        log->Append({WalRecord::Kind::ADD_DOCUMENT, writer * 10 + i, DocumentStatus::ACTUAL, {1}, "pet"s});
+                    } catch (const std::runtime_error&) {
+                        ++failed_appends;
+                    }
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        ASSERT_EQUAL(failed_appends.load(), 40);
+        ASSERT(log->IsFailed());
+        ASSERT_EQUAL(log->GetRecordCount(), 0u);
+    }
+    {//reopening truncates a torn tail, so later records are replayed
+        {
+            WriteAheadLog log(log_path, false);
+            log.Append({WalRecord::Kind::ADD_DOCUMENT, 1, DocumentStatus::ACTUAL, {1}, "funny pet"s});
+        }
+        std::ofstream(log_path, std::ios::binary | std::ios::app) << "\x40\x00\x00\x00torn"s;
+        {
+            WriteAheadLog log(log_path, false);
+            log.Append({WalRecord::Kind::ADD_DOCUMENT, 2, DocumentStatus::ACTUAL, {1}, "curly cat"s});
+        }
+        const auto records = ReadWriteAheadLog(log_path);
+        ASSERT_EQUAL(records.size(), 2u);
+        ASSERT_EQUAL(records.back().document_id, 2);
+        ASSERT_EQUAL(records.back().sequence_number, 2u); //numbering continues after the file
+    }
+    std::filesystem::remove(log_path);
+}
+
+void TestWildcardQueries() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cats and catfish"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "a cot near the coat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "dog and puppy"s, DocumentStatus::ACTUAL, {4});
+    auto found_ids = [&server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    for (const bool frozen : {false, true}) {
+        const string hint = frozen ? "frozen segment"s : "mutable segment"s;
+        if (frozen) {//the same results when words are split between segments
+            server.FreezeMutableSegment();
+            server.AddDocument(5, "catalog of coats"s, DocumentStatus::ACTUAL, {5});
+            server.RemoveDocument(5);
+        }
+        ASSERT_HINT(found_ids("cat*"s) == (vector<int>{1, 2}), hint);
+        ASSERT_HINT(found_ids("c?t"s) == (vector<int>{1, 3}), hint);
+        ASSERT_HINT(found_ids("c*t"s) == (vector<int>{1, 3}), hint);
+        ASSERT_HINT(found_ids("*y"s) == (vector<int>{1, 4}), hint);
+        ASSERT_HINT(found_ids("c* -cat?"s) == (vector<int>{1, 3}), hint);
+        ASSERT_HINT(found_ids("bird*"s) == vector<int>{}, hint);
+        
+        const auto [words, status] = server.MatchDocument("cat* dog"s, 2);
+        ASSERT_HINT(words == (vector<string>{"catfish"s, "cats"s}), hint);
+    }
+    {//an expanded word scores like the same word written in the query
+        const auto expanded = server.FindTopDocuments("catf*"s);
+        const auto written = server.FindTopDocuments("catfish"s);
+        ASSERT_EQUAL(expanded.size(), 1u);
+        ASSERT_EQUAL(written.size(), 1u);
+        ASSERT(std::abs(expanded[0].relevance - written[0].relevance) < SearchServer::PRECISION_EPSILON);
+    }
+    {//expansions are capped, first words in sorted order are kept
+        server.SetMaxWordExpansions(1);
+        ASSERT(found_ids("cat*"s) == vector<int>{1});
+        server.SetMaxWordExpansions(0);
+        ASSERT(found_ids("cat*"s) == vector<int>{});
+        //minus words are not capped, catfish and cats exclude document 2 as well
+        server.SetMaxWordExpansions(1);
+        ASSERT(found_ids("city catfish -cat*"s) == vector<int>{});
+        ASSERT(found_ids("coat dog -*at"s) == vector<int>{4});
+        server.SetMaxWordExpansions(SearchServer::DEFAULT_MAX_WORD_EXPANSIONS);
+    }
+    {//prepared wildcard queries pick up new words
+        const PreparedQuery query = server.Prepare("pupp*"s);
+        ASSERT_EQUAL(server.FindTopDocuments(query).size(), 1u);
+        server.AddDocument(6, "puppies"s, DocumentStatus::ACTUAL, {6});
+        ASSERT_EQUAL(server.FindTopDocuments(query).size(), 2u);
+    }
+    ASSERT(MatchesWildcardPattern("catfish"s, "c*f?sh"s));
+    ASSERT(MatchesWildcardPattern("ab"s, "a**b*"s));
+    ASSERT(!MatchesWildcardPattern("catfish"s, "c*t"s));
+    ASSERT(!MatchesWildcardPattern(""s, "?"s));
+}
+
+void TestFuzzyMatching() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    {//misspelled words match nothing until fuzzy matching is enabled
+        ASSERT(server.FindTopDocuments("flufy"s).empty());
+        RequestQueue request_queue(server);
+        request_queue.AddFindRequest("flufy"s);
+        server.EnableFuzzyMatching();
+        request_queue.AddFindRequest("flufy"s);
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+    }
+    {//substitution, transposition and two edits are corrected, minus words are not
+        ASSERT_EQUAL(server.FindTopDocuments("fluffu"s).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("dgo"s).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("grmed"s).size(), 1u);
+        ASSERT(server.FindTopDocuments("xyzzy"s).empty());
+        ASSERT_EQUAL(server.FindTopDocuments("cat -flufy"s).size(), 2u);
+        
+        const auto [words, status] = server.MatchDocument("whiet cat"s, 1);
+        ASSERT(words == (vector<string>{"cat"s, "white"s}));
+    }
+    {//words of removed documents do not hide live words farther away
+        server.AddDocument(10, "flufy gromed"s, DocumentStatus::ACTUAL, {1});
+        server.RemoveDocument(10);
+        const auto fluffy = server.FindTopDocuments("flufy"s);
+        ASSERT_EQUAL(fluffy.size(), 1u);
+        ASSERT_EQUAL(fluffy[0].id, 2);
+        const auto groomed = server.FindTopDocuments("grmed"s);
+        ASSERT_EQUAL(groomed.size(), 1u);
+        ASSERT_EQUAL(groomed[0].id, 3);
+    }
+    {//only the closest words are used, with relevance lowered per edit
+        const auto exact = server.FindTopDocuments("collar"s);
+        const auto one_edit = server.FindTopDocuments("colar"s);
+        ASSERT_EQUAL(one_edit.size(), 1u);
+        ASSERT(std::abs(one_edit[0].relevance - exact[0].relevance * SearchServer::DEFAULT_FUZZY_RELEVANCE_PENALTY) < SearchServer::PRECISION_EPSILON);
+        server.EnableFuzzyMatching(1, 0.25);
+        ASSERT(server.FindTopDocuments("grmed"s).empty());
+        ASSERT(std::abs(server.FindTopDocuments("colar"s)[0].relevance - exact[0].relevance * 0.25) < SearchServer::PRECISION_EPSILON);
+    }
+    {//new words are added to the index, copies of the server do not share changes
+        SearchServer copy = server;
+        copy.AddDocument(4, "parrot"s, DocumentStatus::ACTUAL, {1});
+        copy.FreezeMutableSegment();
+        ASSERT_EQUAL(copy.FindTopDocuments("parot"s).size(), 1u);
+        ASSERT(server.FindTopDocuments("parot"s).empty());
+        ASSERT(copy.GetMemoryStats().fuzzy_index.objects > server.GetMemoryStats().fuzzy_index.objects);
+    }
+    {
+        server.DisableFuzzyMatching();
+        ASSERT(server.FindTopDocuments("colar"s).empty());
+        ASSERT_EQUAL(server.GetMemoryStats().fuzzy_index.bytes, 0u);
+        bool thrown = false;
+        try {
+            server.EnableFuzzyMatching(3);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    {//copies share frozen chunks, words are found in all chunks and in the delta
+        DeletionIndex index(2);
+        for (int i = 0; i < 1000; ++i) {
+            index.AddWord("word"s + std::to_string(i));
+        }
+        index.AddWord("word5"s);
+        ASSERT_EQUAL(index.GetWordCount(), 1000u);
+        ASSERT_EQUAL(index.GetChunkCount(), 2u); //512 + 256 words, 232 in the delta
+        const auto accept_all = [](std::string_view) { return true; };
+        for (const string& word : {"wrd0"s, "wrd700"s, "wrd999"s}) {
+            const auto closest = index.FindClosestWords(word, accept_all);
+            ASSERT_EQUAL_HINT(closest.size(), 1u, word);
+            ASSERT_EQUAL_HINT(closest[0].edit_distance, 1, word);
+        }
+        const auto farther = index.FindClosestWords("wrd999"s, [](std::string_view word) { return word != "word999"; });
+        ASSERT(!farther.empty());
+        for (const WordCorrection& correction : farther) {
+            ASSERT_EQUAL_HINT(correction.edit_distance, 2, correction.word);
+        }
+        
+        DeletionIndex copy = index;
+        copy.AddWord("parrot"s);
+        ASSERT_EQUAL(copy.FindClosestWords("parot"s, accept_all).size(), 1u);
+        ASSERT(index.FindClosestWords("parot"s, accept_all).empty());
+    }
+    ASSERT_EQUAL(ComputeEditDistance("kitten"s, "sitting"s, 5), 3);
+    ASSERT_EQUAL(ComputeEditDistance("kitten"s, "sitting"s, 2), 3);
+    ASSERT_EQUAL(ComputeEditDistance("ca"s, "ac"s, 2), 1);
+}
+
+void TestRemoveDuplicates() {
+    auto make_server = [] {
+        SearchServer server("and with"s);
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        //same words as 2, repeated and reordered, differing only in stop words
+        server.AddDocument(3, "curly hair funny and pet pet"s, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::BANNED, {1, 2});
+        //subset of words of 1
+        server.AddDocument(5, "funny pet rat"s, DocumentStatus::ACTUAL, {1, 2});
+        server.AddDocument(6, "nasty rat funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+        return server;
+    };
+    {
+        SearchServer server = make_server();
+        ASSERT_EQUAL(server.GetWordSetFingerprint(2), server.GetWordSetFingerprint(3));
+        ASSERT(server.GetWordSetFingerprint(1) != server.GetWordSetFingerprint(5));
+        
+        std::ostringstream output;
+        auto* const old_buffer = std::cout.rdbuf(output.rdbuf());
+        const vector<int> removed_ids = RemoveDuplicates(server);
+        std::cout.rdbuf(old_buffer);
+        ASSERT(removed_ids == (vector<int>{3, 4, 6}));
+        ASSERT_EQUAL(output.str(), "Found duplicate document id 3\nFound duplicate document id 4\nFound duplicate document id 6\n"s);
+        ASSERT_EQUAL(server.GetDocumentCount(), 3);
+        ASSERT(server.FindDuplicateDocumentIds().empty());
+    }
+    {//duplicates are dropped on insert, a lower id replaces a stored duplicate
+        SearchServer server("and with"s);
+        server.SetDuplicateDetection(true);
+        server.AddDocument(10, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7});
+        server.AddDocument(12, "nasty rat funny pet"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(11, "curly hair"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(5, "rat with pet nasty funny"s, DocumentStatus::ACTUAL, {2});
+        ASSERT(server.TakeDroppedDuplicateIds() == (vector<int>{12, 10}));
+        ASSERT(server.TakeDroppedDuplicateIds().empty());
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        ASSERT_EQUAL(server.GetDocumentId(0), 5);
+        //a removed document does not make its words a duplicate
+        server.RemoveDocument(11);
+        server.AddDocument(13, "curly hair"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        ASSERT(server.TakeDroppedDuplicateIds().empty());
+    }
+    {//enabling detection picks up stored documents
+        SearchServer server = make_server();
+        server.SetDuplicateDetection(true);
+        server.AddDocument(7, "hair curly pet funny"s, DocumentStatus::ACTUAL, {1});
+        ASSERT(server.TakeDroppedDuplicateIds() == vector<int>{7});
+    }
+}
+
+void TestThreadPool() {
+    ThreadPool thread_pool(4);
+    ASSERT_EQUAL(thread_pool.GetThreadCount(), 4u);
+    {//results and exceptions are passed through futures
+        auto answer = thread_pool.Submit([] { return 42; });
+        ASSERT_EQUAL(thread_pool.Wait(std::move(answer)), 42);
+        auto failure = thread_pool.Submit([]() -> int { throw std::invalid_argument("task failed"); });
+        bool thrown = false;
+        try {
+            thread_pool.Wait(std::move(failure));
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    {//a thread with nothing to run waits for a task running on a worker
+        std::atomic<bool> is_started = false;
+        std::atomic<bool> is_finished = false;
+        auto sleeping_task = thread_pool.Submit([&is_started, &is_finished] {
+            is_started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            is_finished = true;
+        });
+        //the task must run on a worker, not on the waiting thread
+        while (!is_started) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        thread_pool.Wait(std::move(sleeping_task));
+        ASSERT(is_finished);
+        const ThreadPoolStats stats = thread_pool.GetStats();
+        ASSERT_EQUAL(stats.executed_tasks, stats.submitted_tasks);
+    }
+    {//nested parallel loops do not deadlock, every index is visited once
+        const size_t outer_count = 16;
+        const size_t inner_count = 1000;
+        vector<std::atomic<int>> visits(outer_count * inner_count);
+        thread_pool.ParallelFor(outer_count, [&](size_t outer_begin, size_t outer_end) {
+            for (size_t i = outer_begin; i < outer_end; ++i) {
+                thread_pool.ParallelFor(inner_count, [&, i](size_t begin, size_t end) {
+                    for (size_t j = begin; j < end; ++j) {
+                        ++visits[i * inner_count + j];
+                    }
+                });
+            }
+        });
+        ASSERT(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& count) { return count == 1; }));
+    }
+    {//tasks queued by one worker are stolen by the others
+        thread_pool.Wait(thread_pool.Submit([&thread_pool] {
+            vector<std::future<void>> tasks;
+            for (int i = 0; i < 64; ++i) {
+                tasks.push_back(thread_pool.Submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }));
+            }
+            for (auto& task : tasks) {
+                thread_pool.Wait(std::move(task));
+            }
+        }));
+        const ThreadPoolStats stats = thread_pool.GetStats();
+        ASSERT(stats.stolen_tasks > 0);
+        ASSERT_EQUAL(stats.executed_tasks, stats.submitted_tasks);
+        ASSERT_EQUAL(stats.queue_depths.size(), 4u);
+        ASSERT_EQUAL(std::accumulate(stats.queue_depths.begin(), stats.queue_depths.end(), size_t{0}), 0u);
+    }
+    {//bulk ingestion and batch queries give the same results as sequential calls
+        const vector<NewDocument> documents = {
+            {1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7}},
+            {2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3}},
+            {3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8}},
+            {4, "big dog cat Vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2}},
+            {5, "big dog hamster Borya"s, DocumentStatus::ACTUAL, {1, 1, 1}},
+        };
+        SearchServer sequential_server("and with"s);
+        for (const auto& document : documents) {
+            sequential_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        SearchServer bulk_server("and with"s);
+        bulk_server.AddDocuments(documents, thread_pool);
+        const vector<string> queries = {"nasty rat -not"s, "not very funny nasty pet"s, "curly hair"s, "big -cat"s};
+        const auto results = ProcessQueries(bulk_server, queries, thread_pool);
+        ASSERT_EQUAL(results.size(), queries.size());
+        size_t joined_size = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto expected = sequential_server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL_HINT(results[i].size(), expected.size(), queries[i]);
+            for (size_t j = 0; j < expected.size() && j < results[i].size(); ++j) {
+                ASSERT_EQUAL_HINT(results[i][j].id, expected[j].id, queries[i]);
+            }
+            joined_size += expected.size();
+        }
+        ASSERT_EQUAL(ProcessQueriesJoined(bulk_server, queries, thread_pool).size(), joined_size);
+        
+        //documents before the invalid one are added
+        SearchServer partial_server("and with"s);
+        bool thrown = false;
+        try {
+            partial_server.AddDocuments({{1, "funny pet"s, DocumentStatus::ACTUAL, {}}, {2, "bad\x12text"s, DocumentStatus::ACTUAL, {}}, {3, "cat"s, DocumentStatus::ACTUAL, {}}}, thread_pool);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(partial_server.GetDocumentCount(), 1);
+    }
+}
+
+void TestMinusWordExclusion() {
+    SearchServer server("and with"s);
+    server.SetMutableSegmentLimit(3);
+    for (int id = 0; id < 10; ++id) {
+        server.AddDocument(id, id % 2 == 0 ? "common even word"s : "common odd word"s, DocumentStatus::ACTUAL, {id});
+    }
+    {//the predicate is only called for documents without minus words
+        vector<int> checked_ids;
+        const auto found = server.FindTopDocuments("common -even"s, [&checked_ids](int document_id, DocumentStatus, int) {
+            checked_ids.push_back(document_id);
+            return true;
+        });
+        ASSERT_EQUAL(found.size(), static_cast<size_t>(SearchServer::MAX_RESULT_DOCUMENT_COUNT));
+        ASSERT(std::all_of(checked_ids.begin(), checked_ids.end(), [](int document_id) { return document_id % 2 == 1; }));
+        ASSERT_EQUAL(checked_ids.size(), 5u);
+    }
+    {//prepared exclusions are used by MatchDocument and refreshed after changes
+        const PreparedQuery query = server.Prepare("common -odd"s);
+        ASSERT(std::get<0>(server.MatchDocument(query, 3)).empty());
+        ASSERT_EQUAL(std::get<0>(server.MatchDocument(query, 4)).size(), 1u);
+        server.AddDocument(11, "odd"s, DocumentStatus::ACTUAL, {});
+        server.AddDocument(12, "common odd"s, DocumentStatus::ACTUAL, {});
+        ASSERT(std::get<0>(server.MatchDocument(query, 12)).empty());
+    }
+    {//dense ids are stored as a bitmap, sparse ones as sorted ids
+        const DocumentIdSet dense({5, 3, 7, 3, 100});
+        ASSERT(dense.IsBitmap());
+        ASSERT_EQUAL(dense.GetSize(), 4u);
+        const DocumentIdSet sparse({1, 2'000'000'000});
+        ASSERT(!sparse.IsBitmap());
+        for (const DocumentIdSet* set : {&dense, &sparse}) {
+            ASSERT(!set->Contains(0));
+            ASSERT(!set->Contains(-1));
+            ASSERT(!set->Contains(2'000'000'001));
+        }
+        ASSERT(dense.Contains(3) && dense.Contains(100) && !dense.Contains(4) && !dense.Contains(101));
+        ASSERT(sparse.Contains(1) && sparse.Contains(2'000'000'000) && !sparse.Contains(2));
+        ASSERT(DocumentIdSet().Empty());
+        ASSERT(!DocumentIdSet().Contains(0));
+    }
+}
+
+void TestPhraseQueries() {
+    SearchServer server("and with the"s);
+    {//without positions the operators are ordinary words; positions can only be enabled on an empty server
+        SearchServer plain_server("and with"s);
+        plain_server.AddDocument(1, "curly dog"s, DocumentStatus::ACTUAL, {1});
+        plain_server.AddDocument(2, "\"curly NEAR/2 cat\""s, DocumentStatus::ACTUAL, {2});
+        const auto near_documents = plain_server.FindTopDocuments("curly NEAR/2 dog"s);
+        ASSERT_EQUAL(near_documents.size(), 2u);
+        const auto quoted_documents = plain_server.FindTopDocuments("\"curly dog -cat\""s);
+        ASSERT_EQUAL(quoted_documents.size(), 1u);
+        ASSERT_EQUAL(quoted_documents[0].id, 1);
+        ASSERT(plain_server.FindTopDocuments("cat\" -\"curly"s).empty());
+        bool thrown = false;
+        try {
+            plain_server.EnablePositionalIndex();
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    server.EnablePositionalIndex();
+    ASSERT(server.HasPositionalIndex());
+    server.SetMutableSegmentLimit(2);
+    server.AddDocument(1, "curly dog and fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog with curly tail"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "curly and dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "the big curly fluffy dog"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "dog dog cat curly curly dog"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(6, "fluffy cat"s, DocumentStatus::ACTUAL, {6});
+    server.AddDocument(7, "curly dog"s, DocumentStatus::ACTUAL, {7});
+    server.RemoveDocument(7);
+    auto found_ids = [&server](const string& query) {
+        vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    //documents are spread over frozen and merged segments and the mutable segment
+    ASSERT(server.GetSegmentCount() > 0);
+    for (const bool rebuilt : {false, true}) {
+        const string hint = rebuilt ? "rebuilt"s : "segments"s;
+        if (rebuilt) {
+            server.RebuildSegments();
+        }
+        ASSERT_HINT(found_ids("\"curly dog\""s) == (vector<int>{1, 5}), hint);
+        //a stop word keeps its place in the phrase and matches any word there
+        ASSERT_HINT(found_ids("\"curly and dog\""s) == (vector<int>{3, 4, 5}), hint);
+        ASSERT_HINT(found_ids("\" curly with dog \""s) == (vector<int>{3, 4, 5}), hint);
+        ASSERT_HINT(found_ids("\"dog curly\""s).empty(), hint);
+        ASSERT_HINT(found_ids("\"curly dog\" -cat"s).empty(), hint);
+        //phrase is required, other words only add relevance
+        ASSERT_HINT(found_ids("\"fluffy cat\" tail"s) == (vector<int>{1, 6}), hint);
+        ASSERT_HINT(found_ids("curly NEAR/1 dog"s) == (vector<int>{1, 5}), hint);
+        ASSERT_HINT(found_ids("curly NEAR/2 dog"s) == (vector<int>{1, 2, 3, 4, 5}), hint);
+        ASSERT_HINT(found_ids("dog NEAR/1 cat"s) == vector<int>{5}, hint);
+        ASSERT_HINT(found_ids("dog NEAR/2 dog"s) == vector<int>{5}, hint);
+        ASSERT_HINT(found_ids("curly NEAR/1 dog NEAR/1 cat"s) == vector<int>{5}, hint);
+        
+        const auto [words, status] = server.MatchDocument("\"curly dog\" tail"s, 2);
+        ASSERT_HINT(words.empty(), hint);
+        const auto [matched_words, matched_status] = server.MatchDocument("\"curly dog\" cat"s, 1);
+        ASSERT_HINT(matched_words == (vector<string>{"cat"s, "curly"s, "dog"s}), hint);
+    }
+    for (const string& query : {"\"curly dog"s, "-\"curly dog\""s, "\"curly -dog\""s, "\"cur* dog\""s,
+                                "NEAR/2 dog"s, "curly NEAR/2"s, "-curly NEAR/2 dog"s, "curly NEAR/2 NEAR/2 dog"s}) {
+        bool thrown = false;
+        try {
+            server.FindTopDocuments(query);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT_HINT(thrown, query);
+    }
+    {//positions are delta and varint encoded
+        const vector<uint32_t> positions = {0, 5, 130, 20'000, 4'000'000'000u};
+        const string encoded = EncodePositions(positions);
+        ASSERT_EQUAL(encoded.size(), 1u + 1u + 1u + 3u + 5u);
+        vector<uint32_t> decoded;
+        DecodePositions(encoded, decoded);
+        ASSERT(decoded == positions);
+    }
+}
+
+void TestStopWordSet() {
+    using std::operator""sv;
+    {//runtime table, all words are found at distinct slots
+        std::set<string> words;
+        for (int i = 0; i < 500; ++i) {
+            words.insert("w"s + std::to_string(i * 7));
+        }
+        const StopWordSet stop_words(words);
+        ASSERT_EQUAL(stop_words.GetSize(), words.size());
+        for (const string& word : words) {
+            ASSERT_HINT(stop_words.Contains(word), word);
+        }
+        ASSERT(!stop_words.Contains("w1"sv));
+        ASSERT(!stop_words.Contains("w"sv));
+        ASSERT(!stop_words.Contains(""sv));
+        ASSERT(!StopWordSet().Contains("w0"sv));
+        ASSERT(!StopWordSet(std::set<string>{}).Contains("w0"sv));
+    }
+    {//table built by the compiler
+        static constexpr StaticStopWordSet STOP_WORDS(std::array{"and"sv, "in"sv, "with"sv, ""sv, "in"sv, "the"sv});
+        static_assert(STOP_WORDS.GetSize() == 4);
+        static_assert(STOP_WORDS.Contains("with"sv));
+        static_assert(!STOP_WORDS.Contains("cat"sv));
+        static_assert(!StaticStopWordSet(std::array<std::string_view, 0>{}).Contains("and"sv));
+        
+        const StopWordSet stop_words(STOP_WORDS);
+        ASSERT_EQUAL(stop_words.GetSize(), 4u);
+        ASSERT(stop_words.Contains("the"sv) && stop_words.Contains("and"sv));
+        ASSERT(!stop_words.Contains(""sv) && !stop_words.Contains("an"sv));
+        
+        SearchServer server(STOP_WORDS);
+        server.AddDocument(1, "cat with the tail"s, DocumentStatus::ACTUAL, {1});
+        const auto [words, status] = server.MatchDocument("the cat in tail"s, 1);
+        ASSERT(words == (vector<string>{"cat"s, "tail"s}));
+        ASSERT(server.FindTopDocuments("and the"s).empty());
+        ASSERT_EQUAL(server.GetMemoryStats().stop_words.objects, 4u);
+    }
+    {//a realistic stop word list fits into the default constexpr limits of the compilers
+        static constexpr StaticStopWordSet STOP_WORDS(std::array{
+            "a"sv, "able"sv, "about"sv, "above"sv, "abroad"sv, "according"sv, "accordingly"sv, "across"sv,
+            "actually"sv, "adj"sv, "after"sv, "afterwards"sv, "again"sv, "against"sv, "ago"sv, "ahead"sv, "aint"sv,
+            "all"sv, "allow"sv, "allows"sv, "almost"sv, "alone"sv, "along"sv, "alongside"sv, "already"sv, "also"sv,
+            "although"sv, "always"sv, "am"sv, "amid"sv, "amidst"sv, "among"sv, "amongst"sv, "an"sv, "and"sv,
+            "another"sv, "any"sv, "anybody"sv, "anyhow"sv, "anyone"sv, "anything"sv, "anyway"sv, "anyways"sv,
+            "anywhere"sv, "apart"sv, "appear"sv, "appreciate"sv, "appropriate"sv, "are"sv, "arent"sv, "around"sv,
+            "as"sv, "aside"sv, "ask"sv, "asking"sv, "associated"sv, "at"sv, "available"sv, "away"sv, "awfully"sv,
+            "back"sv, "backward"sv, "backwards"sv, "be"sv, "became"sv, "because"sv, "become"sv, "becomes"sv,
+            "becoming"sv, "been"sv, "before"sv, "beforehand"sv, "begin"sv, "behind"sv, "being"sv, "believe"sv,
+            "below"sv, "beside"sv, "besides"sv, "best"sv, "better"sv, "between"sv, "beyond"sv, "both"sv, "brief"sv,
+            "but"sv, "by"sv, "came"sv, "can"sv, "cannot"sv, "cant"sv, "caption"sv, "cause"sv, "causes"sv, "certain"sv,
+            "certainly"sv, "changes"sv, "clearly"sv, "cmon"sv, "co"sv, "com"sv, "come"sv, "comes"sv, "concerning"sv,
+            "consequently"sv, "consider"sv, "considering"sv, "contain"sv, "containing"sv, "contains"sv,
+            "corresponding"sv, "could"sv, "couldnt"sv, "course"sv, "currently"sv, "dare"sv, "darent"sv,
+            "definitely"sv, "described"sv, "despite"sv, "did"sv, "didnt"sv, "different"sv, "directly"sv, "do"sv,
+            "does"sv, "doesnt"sv, "doing"sv, "done"sv, "dont"sv, "down"sv, "downwards"sv, "during"sv, "each"sv,
+            "edu"sv, "eg"sv, "eight"sv, "eighty"sv, "either"sv, "else"sv, "elsewhere"sv, "end"sv, "ending"sv,
+            "enough"sv, "entirely"sv, "especially"sv, "et"sv, "etc"sv, "even"sv, "ever"sv, "evermore"sv, "every"sv,
+            "everybody"sv, "everyone"sv, "everything"sv, "everywhere"sv, "ex"sv, "exactly"sv, "example"sv, "except"sv,
+            "fairly"sv, "far"sv, "farther"sv, "few"sv, "fewer"sv, "fifth"sv, "first"sv, "five"sv, "followed"sv,
+            "following"sv, "follows"sv, "for"sv, "forever"sv, "former"sv, "formerly"sv, "forth"sv, "forward"sv,
+            "found"sv, "four"sv, "from"sv, "further"sv, "furthermore"sv, "get"sv, "gets"sv, "getting"sv, "given"sv,
+            "gives"sv, "go"sv, "goes"sv, "going"sv, "gone"sv, "got"sv, "gotten"sv, "greetings"sv, "had"sv, "hadnt"sv,
+            "half"sv, "happens"sv, "hardly"sv, "has"sv, "hasnt"sv, "have"sv, "havent"sv, "having"sv, "he"sv, "hed"sv,
+            "hell"sv, "hello"sv, "help"sv, "hence"sv, "her"sv, "here"sv, "hereafter"sv, "hereby"sv, "herein"sv,
+            "heres"sv, "hereupon"sv, "hers"sv, "herself"sv, "hes"sv, "hi"sv, "him"sv, "himself"sv, "his"sv,
+            "hither"sv, "hopefully"sv, "how"sv, "howbeit"sv, "however"sv, "hundred"sv, "id"sv, "ie"sv, "if"sv,
+            "ignored"sv, "ill"sv, "im"sv, "immediate"sv, "in"sv, "inasmuch"sv, "inc"sv, "indeed"sv, "indicate"sv,
+            "indicated"sv, "indicates"sv, "inner"sv, "inside"sv, "insofar"sv, "instead"sv, "into"sv, "inward"sv,
+            "is"sv, "isnt"sv, "it"sv, "itd"sv, "itll"sv, "its"sv, "itself"sv, "ive"sv, "just"sv, "keep"sv, "keeps"sv,
+            "kept"sv, "know"sv, "known"sv, "knows"sv, "last"sv, "lately"sv, "later"sv, "latter"sv, "latterly"sv,
+            "least"sv, "less"sv, "lest"sv, "let"sv, "lets"sv, "like"sv, "liked"sv, "likely"sv, "likewise"sv,
+            "little"sv, "look"sv, "looking"sv, "looks"sv, "low"sv, "lower"sv, "ltd"sv, "made"sv, "mainly"sv, "make"sv,
+            "makes"sv, "many"sv, "may"sv, "maybe"sv, "maynt"sv, "me"sv, "mean"sv, "meantime"sv, "meanwhile"sv,
+            "merely"sv, "might"sv, "mightnt"sv, "mine"sv, "minus"sv, "miss"sv, "more"sv, "moreover"sv, "most"sv,
+            "mostly"sv, "mr"sv, "mrs"sv, "much"sv, "must"sv, "mustnt"sv, "my"sv, "myself"sv, "name"sv, "namely"sv,
+            "nd"sv, "near"sv, "nearly"sv, "necessary"sv, "need"sv, "neednt"sv, "needs"sv, "neither"sv, "never"sv,
+            "neverf"sv, "neverless"sv, "nevertheless"sv, "new"sv, "next"sv, "nine"sv, "ninety"sv, "no"sv, "nobody"sv,
+            "non"sv, "none"sv, "nonetheless"sv, "noone"sv, "nor"sv, "normally"sv, "not"sv, "nothing"sv,
+            "notwithstanding"sv, "novel"sv, "now"sv, "nowhere"sv, "obviously"sv, "of"sv, "off"sv, "often"sv, "oh"sv,
+            "ok"sv, "okay"sv, "old"sv, "on"sv, "once"sv, "one"sv, "ones"sv, "only"sv, "onto"sv, "opposite"sv, "or"sv,
+            "other"sv, "others"sv, "otherwise"sv, "ought"sv, "oughtnt"sv, "our"sv, "ours"sv, "ourselves"sv, "out"sv,
+            "outside"sv, "over"sv, "overall"sv, "own"sv, "particular"sv, "particularly"sv, "past"sv, "per"sv,
+            "perhaps"sv, "placed"sv, "please"sv, "plus"sv, "possible"sv, "presumably"sv, "probably"sv, "provided"sv,
+            "provides"sv, "que"sv, "quite"sv, "qv"sv, "rather"sv, "rd"sv, "re"sv, "really"sv, "reasonably"sv,
+            "recent"sv, "recently"sv, "regarding"sv, "regardless"sv, "regards"sv, "relatively"sv, "respectively"sv,
+            "right"sv, "round"sv, "said"sv, "same"sv, "saw"sv, "say"sv, "saying"sv, "says"sv, "second"sv,
+            "secondly"sv, "see"sv, "seeing"sv, "seem"sv, "seemed"sv, "seeming"sv, "seems"sv, "seen"sv, "self"sv,
+            "selves"sv, "sensible"sv, "sent"sv, "serious"sv, "seriously"sv, "seven"sv, "several"sv, "shall"sv,
+            "shant"sv, "she"sv, "shed"sv, "shell"sv, "shes"sv, "should"sv, "shouldnt"sv, "since"sv, "six"sv, "so"sv,
+            "some"sv, "somebody"sv, "someday"sv, "somehow"sv, "someone"sv, "something"sv, "sometime"sv, "sometimes"sv,
+            "somewhat"sv, "somewhere"sv, "soon"sv, "sorry"sv, "specified"sv, "specify"sv, "specifying"sv, "still"sv,
+            "sub"sv, "such"sv, "sup"sv, "sure"sv, "take"sv, "taken"sv, "taking"sv, "tell"sv, "tends"sv, "th"sv,
+            "than"sv, "thank"sv, "thanks"sv, "thanx"sv, "that"sv, "thatll"sv, "thats"sv, "thatve"sv, "the"sv,
+            "their"sv, "theirs"sv, "them"sv, "themselves"sv, "then"sv, "thence"sv, "there"sv, "thereafter"sv,
+            "thereby"sv, "thered"sv, "therefore"sv, "therein"sv, "therell"sv, "therere"sv, "theres"sv, "thereupon"sv,
+            "thereve"sv, "these"sv, "they"sv, "theyd"sv, "theyll"sv, "theyre"sv, "theyve"sv, "thing"sv, "things"sv,
+            "think"sv, "third"sv, "thirty"sv, "this"sv, "thorough"sv, "thoroughly"sv, "those"sv, "though"sv,
+            "three"sv, "through"sv, "throughout"sv, "thru"sv, "thus"sv, "till"sv, "to"sv, "together"sv, "too"sv,
+            "took"sv, "toward"sv, "towards"sv, "tried"sv, "tries"sv, "truly"sv, "try"sv, "trying"sv, "twice"sv,
+            "two"sv, "un"sv, "under"sv, "underneath"sv, "undoing"sv, "unfortunately"sv, "unless"sv, "unlike"sv,
+            "unlikely"sv, "until"sv, "unto"sv, "up"sv, "upon"sv, "upwards"sv, "us"sv, "use"sv, "used"sv, "useful"sv,
+            "uses"sv, "using"sv, "usually"sv, "value"sv, "various"sv, "versus"sv, "very"sv, "via"sv, "viz"sv, "vs"sv,
+            "want"sv, "wants"sv, "was"sv, "wasnt"sv, "way"sv, "we"sv, "wed"sv, "welcome"sv, "well"sv, "went"sv,
+            "were"sv, "werent"sv, "weve"sv, "what"sv, "whatever"sv, "whatll"sv, "whats"sv, "whatve"sv, "when"sv,
+            "whence"sv, "whenever"sv, "where"sv, "whereafter"sv, "whereas"sv, "whereby"sv, "wherein"sv, "wheres"sv,
+            "whereupon"sv, "wherever"sv, "whether"sv, "which"sv, "whichever"sv, "while"sv, "whilst"sv, "whither"sv,
+            "who"sv, "whod"sv, "whoever"sv, "whole"sv, "wholl"sv, "whom"sv, "whomever"sv, "whos"sv, "whose"sv,
+            "why"sv, "will"sv
+        });
+        static_assert(STOP_WORDS.GetSize() == 600);
+        static_assert(STOP_WORDS.Contains("a"sv) && STOP_WORDS.Contains("whose"sv) && STOP_WORDS.Contains("will"sv));
+        static_assert(!STOP_WORDS.Contains("cat"sv) && !STOP_WORDS.Contains(""sv));
+        
+        const StopWordSet stop_words(STOP_WORDS);
+        ASSERT_EQUAL(stop_words.GetSize(), 600u);
+        ASSERT(stop_words.Contains("according"sv) && !stop_words.Contains("dog"sv));
+    }
+}
+
+void TestTieredStorage() {
+    const string directory = (std::filesystem::temp_directory_path() / "search_server_tiered_test"s).string();
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+    
+    SearchServer server("and with"s);
+    server.EnablePositionalIndex();
+    server.SetMutableSegmentLimit(2);
+    const vector<string> texts = {"curly dog and fluffy cat"s, "dog with curly tail"s, "big fluffy cat"s,
+        "curly cat with long tail"s, "small dog"s, "curly parrot"s, "big grey parrot"s, "cat"s};
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+    const SearchServer in_memory = server;
+    const vector<string> queries = {"curly"s, "fluffy cat -dog"s, "\"curly parrot\""s, "dog NEAR/2 tail"s, "parrot big"s};
+    auto check_results = [&](const string& hint) {
+        for (const string& query : queries) {
+            const auto found = server.FindTopDocuments(query);
+            const auto expected = in_memory.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), hint + ": "s + query);
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, hint + ": "s + query);
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < 1e-9, hint + ": "s + query);
+            }
+        }
+        const auto [words, status] = server.MatchDocument("curly cat tail"s, 3);
+        ASSERT_HINT(words == (vector<string>{"cat"s, "curly"s, "tail"s}), hint);
+    };
+    const size_t posting_count = server.GetMemoryStats().frozen_segments.objects;
+    ASSERT_EQUAL(posting_count, 22u);
+    
+    {//no budget: every frozen posting is cold, the files are already unlinked
+        server.EnableTieredStorage(directory, 0);
+        const auto stats = server.GetMemoryStats();
+        ASSERT_EQUAL(stats.cold_postings.objects, posting_count);
+        ASSERT_EQUAL(stats.frozen_segments.objects, 0u);
+        ASSERT(stats.cold_postings.bytes > 0);
+        ASSERT(std::filesystem::is_empty(directory));
+        check_results("all cold"s);
+    }
+    {//curly is looked up most, its 4 postings take 4 * (id + double + 1 position byte)
+        for (int i = 0; i < 10; ++i) {
+            server.FindTopDocuments("curly"s);
+        }
+        server.EnableTieredStorage(directory, 4 * (sizeof(int) + sizeof(double) + 1));
+        const auto stats = server.GetMemoryStats();
+        ASSERT_EQUAL(stats.frozen_segments.objects, 4u);
+        ASSERT_EQUAL(stats.cold_postings.objects, posting_count - 4);
+        //a rebalance that moves nothing keeps prepared queries up to date
+        const PreparedQuery prepared_query = server.Prepare("curly"s);
+        server.RebalanceTiers();
+        ASSERT_EQUAL(server.GetMemoryStats().frozen_segments.objects, 4u);
+        ASSERT(server.IsUpToDate(prepared_query));
+        check_results("curly hot"s);
+    }
+    {//a merged segment over the limit is rebalanced right away
+        server.RebuildSegments();
+        ASSERT_EQUAL(server.GetSegmentCount(), 1u);
+        ASSERT_EQUAL(server.GetMemoryStats().frozen_segments.objects, 4u);
+        check_results("merged"s);
+    }
+    {
+        server.DisableTieredStorage();
+        const auto stats = server.GetMemoryStats();
+        ASSERT_EQUAL(stats.cold_postings.objects, 0u);
+        ASSERT_EQUAL(stats.frozen_segments.objects, posting_count);
+        check_results("in memory"s);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void TestQueryLogReplay() {
+    const string log_path = (std::filesystem::temp_directory_path() / "search_server_query_log_test.qlog"s).string();
+    const string replay_path = (std::filesystem::temp_directory_path() / "search_server_query_replay_test.qlog"s).string();
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::BANNED, {1, 2, 8});
+    server.AddDocument(4, "big dog cat vladislav"s, DocumentStatus::ACTUAL, {1, 3, 2});
+    {
+        RequestQueue request_queue(server);
+        request_queue.SetQueryLog(std::make_shared<QueryLogWriter>(log_path));
+        request_queue.AddFindRequest("curly dog"s);
+        request_queue.AddFindRequest("nasty hair"s, DocumentStatus::BANNED);
+        request_queue.AddFindRequest("big cat"s, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; });
+        request_queue.AddFindRequest(server.Prepare("funny -rat"s));
+        request_queue.AddFindRequest("parrot"s);
+    }
+    auto records = ReadQueryLog(log_path);
+    ASSERT_EQUAL(records.size(), 5u);
+    ASSERT_EQUAL(records[1].query, "nasty hair"s);
+    ASSERT(records[1].kind == QueryLogRecord::Kind::STATUS && records[1].status == DocumentStatus::BANNED);
+    ASSERT(records[2].kind == QueryLogRecord::Kind::PREDICATE);
+    ASSERT_EQUAL(records[3].query, "funny -rat"s);
+    ASSERT_EQUAL(records[3].results.size(), 1u);
+    ASSERT(AreSameResults(records[3].results, server.FindTopDocuments("funny -rat"s)));
+    ASSERT_EQUAL(records[3].results[0].rating, 2);
+    ASSERT(records[4].results.empty());
+    for (size_t i = 1; i < records.size(); ++i) {
+        ASSERT(records[i - 1].timestamp <= records[i].timestamp);
+    }
+    {//the same index gives the same results, also when replayed by two threads
+        const auto report = ReplayQueryLog(server, records, {0.0, 2, replay_path});
+        ASSERT_EQUAL(report.query_count, 5u);
+        ASSERT_EQUAL(report.compared_queries, 4u);
+        ASSERT(report.differing_records.empty());
+        ASSERT(report.latency_p50 <= report.latency_p99 && report.latency_p99 <= report.latency_max);
+        ASSERT_EQUAL(ReadQueryLog(replay_path).size(), 5u);
+    }
+    {//relevances closer than PRECISION_EPSILON are the same, also across a rounding boundary
+        const double boundary = 1000.5 * SearchServer::PRECISION_EPSILON;
+        const vector<Document> logged = {{1, boundary - SearchServer::PRECISION_EPSILON / 100, -3}};
+        ASSERT(AreSameResults(logged, {{1, boundary + SearchServer::PRECISION_EPSILON / 100, -3}}));
+        ASSERT(!AreSameResults(logged, {{1, boundary + SearchServer::PRECISION_EPSILON, -3}}));
+        ASSERT(!AreSameResults(logged, {{2, boundary, -3}}));
+        ASSERT(!AreSameResults(logged, {}));
+    }
+    {//another index: a new document changes all relevances, parrot is found now
+        SearchServer changed_server = server;
+        changed_server.AddDocument(5, "curly parrot"s, DocumentStatus::ACTUAL, {5});
+        const auto report = ReplayQueryLog(changed_server, records, {0.0, 1, {}});
+        ASSERT(report.differing_records == (vector<size_t>{0, 1, 3, 4}));
+    }
+    {//open-loop: requests start at their logged offsets divided by speed
+        for (size_t i = 0; i < records.size(); ++i) {
+            records[i].timestamp = 1'000'000 + i * 40'000;
+        }
+        const auto report = ReplayQueryLog(server, records, {2.0, 1, {}});
+        ASSERT(report.duration_seconds >= 0.08);
+    }
+    {//a torn record at the end is dropped
+        std::filesystem::resize_file(log_path, std::filesystem::file_size(log_path) - 3);
+        ASSERT_EQUAL(ReadQueryLog(log_path).size(), 4u);
+    }
+    std::filesystem::remove(log_path);
+    std::filesystem::remove(replay_path);
+}
+
+void TestPersistentMap() {
+    PersistentMap<int, string> map;
+    ASSERT(map.Empty());
+    for (int key = 0; key < 1000; ++key) {
+        map.InsertOrAssign((key * 7919) % 1000, std::to_string(key));
+    }
+    const PersistentMap<int, string> copy = map;
+    for (int key = 0; key < 1000; key += 2) {
+        ASSERT(map.Erase(key));
+    }
+    ASSERT(!map.Erase(0));
+    map.InsertOrAssign(1, "one"s);
+    map.InsertOrAssign(1001, "last"s);
+    
+    ASSERT_EQUAL(map.GetSize(), 501u);
+    ASSERT_EQUAL(map.At(1), "one"s);
+    ASSERT(map.Find(2) == nullptr);
+    ASSERT_EQUAL(map.GetNth(0).first, 1);
+    ASSERT_EQUAL(map.GetNth(500).first, 1001);
+    //the copy still has every key with its old value
+    ASSERT_EQUAL(copy.GetSize(), 1000u);
+    ASSERT(copy.At(1) != "one"s);
+    vector<int> keys;
+    copy.ForEach([&keys](int key, const string&) { keys.push_back(key); });
+    ASSERT_EQUAL(keys.size(), 1000u);
+    ASSERT(std::is_sorted(keys.begin(), keys.end()) && keys.front() == 0 && keys.back() == 999);
+}
+
 void TestSearchServer() {
     // Не забудьте вызывать остальные тесты здесь
     RUN_TEST(TestDocumentAdd);
@@ -361,5 +1590,22 @@ void TestSearchServer() {
     RUN_TEST(TestStatusFilter);
     RUN_TEST(TestRelevanceCompute);
     RUN_TEST(TestErrorReporting);
+    RUN_TEST(TestConcurrentSnapshotReads);
+    RUN_TEST(TestIndexSegments);
+    RUN_TEST(TestTermFreqPrecision);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestPreparedQueries);
+    RUN_TEST(TestQueryTracing);
+    RUN_TEST(TestWriteAheadLog);
+    RUN_TEST(TestWildcardQueries);
+    RUN_TEST(TestFuzzyMatching);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestThreadPool);
+    RUN_TEST(TestMinusWordExclusion);
+    RUN_TEST(TestPhraseQueries);
+    RUN_TEST(TestStopWordSet);
+    RUN_TEST(TestTieredStorage);
+    RUN_TEST(TestQueryLogReplay);
+    RUN_TEST(TestPersistentMap);
 }
 // --------- Окончание модульных тестов поисковой системы -----------
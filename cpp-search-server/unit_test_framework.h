@@ -1,6 +1,12 @@
 #pragma once
 
+#include "concurrent_search_server.h"
 #include "document.h"
+#include "process_queries.h"
+#include "query_replay.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "score_precision_report.h"
 #include "search_server.h"
 
 using std::operator""s;
@@ -48,6 +54,40 @@ void TestStatusFilter();
 //Корректное вычисление релевантности найденных документов.
 void TestRelevanceCompute();
 void TestErrorReporting();
+//Readers see only published index versions, a held snapshot is not affected by later publications.
+void TestConcurrentSnapshotReads();
+//Frozen and merged segments return the same results as the mutable segment, removed documents are not found.
+void TestIndexSegments();
+//Reduced term frequency precision keeps rankings and bounds the relevance error.
+void TestTermFreqPrecision();
+//Memory statistics count objects of every structure and find the heaviest terms.
+void TestMemoryStats();
+//Prepared queries return the same results as raw queries and stay valid after the index changes.
+void TestPreparedQueries();
+//Sampled trace spans and counters are dumped in Chrome trace_event format.
+void TestQueryTracing();
+//Logged changes are replayed in order, a torn record at the end of the log is ignored.
+void TestWriteAheadLog();
+//Prefix and wildcard query words are expanded into matching indexed words, up to a configurable cap.
+void TestWildcardQueries();
+//Misspelled plus words are corrected to the closest indexed words with a relevance penalty.
+void TestFuzzyMatching();
+//Documents with equal word sets are found by fingerprint, the lowest id is kept.
+void TestRemoveDuplicates();
+//The work-stealing pool runs nested tasks, batch queries and bulk ingestion.
+void TestThreadPool();
+//Documents with minus words are excluded before plus word postings reach the predicate.
+void TestMinusWordExclusion();
+//Quoted phrases and NEAR/k are matched using the positional index in all segments.
+void TestPhraseQueries();
+//Stop words are found in the perfect hash table, also when it is built at compile time.
+void TestStopWordSet();
+//Cold postings are served from the mapped file and looked-up words are promoted to memory.
+void TestTieredStorage();
+//Requests are logged by RequestQueue and replayed open-loop, differing results are reported.
+void TestQueryLogReplay();
+//Copies of a persistent map share nodes and are changed independently.
+void TestPersistentMap();
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer();
 
@@ -0,0 +1,304 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+#include "search_server.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t ComputeChecksum(string_view data) {
+    uint32_t hash = 2166136261u;
+    for (const char c : data) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+template <typename T>
+void AppendValue(string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+//returns false if the data is too short
+template <typename T>
+bool ReadValue(string_view& data, T& value) {
+    if (data.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(T));
+    data.remove_prefix(sizeof(T));
+    return true;
+}
+
+struct LogScanResult {
+    size_t valid_size = 0;               //complete records with valid checksums at the start of data
+    uint64_t last_sequence_number = 0;   //of the last of them, 0 if there are none
+};
+
+LogScanResult ScanLog(string_view data) {
+    LogScanResult result;
+    string_view rest = data;
+    while (true) {
+        string_view record = rest;
+        uint32_t payload_size = 0;
+        uint32_t checksum = 0;
+        if (!ReadValue(record, payload_size) || !ReadValue(record, checksum) || record.size() < payload_size
+            || ComputeChecksum(record.substr(0, payload_size)) != checksum) {
+            result.valid_size = data.size() - rest.size();
+            return result;
+        }
+        string_view payload = record.substr(0, payload_size);
+        ReadValue(payload, result.last_sequence_number);
+        rest = record.substr(payload_size);
+    }
+}
+
+bool DecodePayload(string_view payload, WalRecord& record) {
+    uint64_t sequence_number = 0;
+    uint8_t kind = 0;
+    int32_t document_id = 0;
+    uint8_t status = 0;
+    int32_t replaced_document_id = 0;
+    uint32_t rating_count = 0;
+    if (!ReadValue(payload, sequence_number) || !ReadValue(payload, kind) || !ReadValue(payload, document_id) || !ReadValue(payload, status)
+        || !ReadValue(payload, replaced_document_id) || !ReadValue(payload, rating_count)
+        || payload.size() < rating_count * sizeof(int32_t)) {
+        return false;
+    }
+    record.sequence_number = sequence_number;
+    record.kind = static_cast<WalRecord::Kind>(kind);
+    record.document_id = document_id;
+    record.status = static_cast<DocumentStatus>(status);
+    record.replaced_document_id = replaced_document_id;
+    record.ratings.resize(rating_count);
+    for (int& rating : record.ratings) {
+        int32_t value = 0;
+        ReadValue(payload, value);
+        rating = value;
+    }
+    uint32_t text_size = 0;
+    if (!ReadValue(payload, text_size) || payload.size() != text_size) {
+        return false;
+    }
+    record.text.assign(payload);
+    return true;
+}
+
+} // namespace
+
+//************* Class Write-Ahead Log *************//
+WriteAheadLog::WriteAheadLog(const string& path, bool sync)
+: file_descriptor_(open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644))
+, sync_(sync) {
+    if (file_descriptor_ < 0) {
+        throw std::runtime_error(WAL_OPEN_ERROR_MSG);
+    }
+    //a write that failed before may have left a torn record, appending after it would hide the new records
+    std::ifstream input(path, std::ios::binary);
+    const string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    const LogScanResult scan = ScanLog(data);
+    last_sequence_number_ = scan.last_sequence_number;
+    durable_sequence_number_ = scan.last_sequence_number;
+    if (scan.valid_size < data.size()) {
+        if (ftruncate(file_descriptor_, static_cast<off_t>(scan.valid_size)) != 0) {
+            close(file_descriptor_);
+            throw std::runtime_error(WAL_OPEN_ERROR_MSG);
+        }
+    }
+}
+
+WriteAheadLog::WriteAheadLog(int file_descriptor, bool sync)
+: file_descriptor_(file_descriptor)
+, sync_(sync) {
+    if (file_descriptor_ < 0) {
+        throw std::runtime_error(WAL_OPEN_ERROR_MSG);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close(file_descriptor_);
+}
+
+uint64_t WriteAheadLog::Append(WalRecord record) {
+    const uint64_t sequence_number = Enqueue(std::move(record));
+    WaitDurable(sequence_number);
+    return sequence_number;
+}
+
+uint64_t WriteAheadLog::Enqueue(WalRecord record) {
+    std::lock_guard guard(mutex_);
+    //numbered and encoded under the lock, so the numbers are in file order
+    record.sequence_number = ++last_sequence_number_;
+    if (!is_failed_) {
+        pending_ += EncodeWalRecord(record);
+        ++pending_records_;
+    }
+    return record.sequence_number;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence_number) {
+    std::unique_lock lock(mutex_);
+    while (durable_sequence_number_ < sequence_number) {
+        //the record was in the failed batch or queued after it
+        if (is_failed_) {
+            throw std::runtime_error(WAL_FAILED_MSG);
+        }
+        if (is_flushing_) {
+            flushed_.wait(lock);
+            continue;
+        }
+        //become the leader of the next group
+        is_flushing_ = true;
+        string batch;
+        batch.swap(pending_);
+        const uint64_t batch_records = std::exchange(pending_records_, 0);
+        const uint64_t batch_end = last_sequence_number_;
+        lock.unlock();
+        try {
+            WriteAndSync(batch);
+        } catch (...) {
+            lock.lock();
+            is_failed_ = true;
+            is_flushing_ = false;
+            pending_.clear();
+            pending_records_ = 0;
+            flushed_.notify_all();
+            throw;
+        }
+        lock.lock();
+        is_flushing_ = false;
+        durable_sequence_number_ = batch_end;
+        durable_records_ += batch_records;
+        ++sync_count_;
+        flushed_.notify_all();
+    }
+}
+
+bool WriteAheadLog::IsFailed() const {
+    std::lock_guard guard(mutex_);
+    return is_failed_;
+}
+
+uint64_t WriteAheadLog::GetRecordCount() const {
+    std::lock_guard guard(mutex_);
+    return durable_records_;
+}
+
+uint64_t WriteAheadLog::GetSyncCount() const {
+    std::lock_guard guard(mutex_);
+    return sync_count_;
+}
+
+//============== Private Methods ==============
+void WriteAheadLog::WriteAndSync(const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(file_descriptor_, data.data() + written, data.size() - written);
+        if (result < 0) {
+            throw std::runtime_error(WAL_WRITE_ERROR_MSG);
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (sync_ && fsync(file_descriptor_) != 0) {
+        throw std::runtime_error(WAL_WRITE_ERROR_MSG);
+    }
+}
+
+//********** End of Class Write-Ahead Log **********//
+
+string EncodeWalRecord(const WalRecord& record) {
+    string payload;
+    AppendValue(payload, record.sequence_number);
+    AppendValue(payload, static_cast<uint8_t>(record.kind));
+    AppendValue(payload, static_cast<int32_t>(record.document_id));
+    AppendValue(payload, static_cast<uint8_t>(record.status));
+    AppendValue(payload, static_cast<int32_t>(record.replaced_document_id));
+    AppendValue(payload, static_cast<uint32_t>(record.ratings.size()));
+    for (const int rating : record.ratings) {
+        AppendValue(payload, static_cast<int32_t>(rating));
+    }
+    AppendValue(payload, static_cast<uint32_t>(record.text.size()));
+    payload += record.text;
+    
+    string encoded;
+    encoded.reserve(RECORD_HEADER_SIZE + payload.size());
+    AppendValue(encoded, static_cast<uint32_t>(payload.size()));
+    AppendValue(encoded, ComputeChecksum(payload));
+    encoded += payload;
+    return encoded;
+}
+
+vector<WalRecord> ReadWriteAheadLog(const string& path, ThreadPool& thread_pool) {
+    std::ifstream input(path, std::ios::binary);
+    const string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    
+    //record boundaries only need the size fields, the rest is decoded in parallel
+    struct RawRecord {
+        string_view payload;
+        uint32_t checksum = 0;
+    };
+    vector<RawRecord> raw_records;
+    string_view rest = data;
+    while (true) {
+        uint32_t payload_size = 0;
+        uint32_t checksum = 0;
+        if (!ReadValue(rest, payload_size) || !ReadValue(rest, checksum) || rest.size() < payload_size) {
+            break; //torn write at the end of the log
+        }
+        raw_records.push_back({rest.substr(0, payload_size), checksum});
+        rest.remove_prefix(payload_size);
+    }
+    
+    vector<WalRecord> records(raw_records.size());
+    vector<char> is_valid(raw_records.size(), 0);
+    thread_pool.ParallelFor(raw_records.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            is_valid[i] = ComputeChecksum(raw_records[i].payload) == raw_records[i].checksum
+                && DecodePayload(raw_records[i].payload, records[i]);
+        }
+    });
+    
+    const size_t valid_count = std::find(is_valid.begin(), is_valid.end(), 0) - is_valid.begin();
+    records.resize(valid_count);
+    return records;
+}
+
+size_t ReplayWriteAheadLog(const string& path, SearchServer& server, ThreadPool& thread_pool) {
+    size_t applied = 0;
+    for (const WalRecord& record : ReadWriteAheadLog(path, thread_pool)) {
+        if (record.sequence_number <= server.GetLogSequenceNumber()) {
+            continue; //already in the snapshot
+        }
+        //only accepted changes are logged, so a failure here means the log does not match the server
+        if (record.kind == WalRecord::Kind::ADD_DOCUMENT) {
+            //the id was reused after the segment holding the removed document had been merged
+            if (server.IsRemovalPending(record.document_id)) {
+                server.RebuildSegments();
+            }
+            if (record.replaced_document_id >= 0) {
+                server.RemoveDocument(record.replaced_document_id);
+            }
+            server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        } else {
+            server.RemoveDocument(record.document_id);
+        }
+        server.SetLogSequenceNumber(record.sequence_number);
+        ++applied;
+    }
+    return applied;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "thread_pool.h"
+
+class SearchServer;
+
+//===== Write-Ahead Log Error Messages ===============
+const std::string WAL_OPEN_ERROR_MSG = "WriteAheadLog ERROR: Cannot open log file";
+const std::string WAL_WRITE_ERROR_MSG = "WriteAheadLog ERROR: Cannot write or sync log file";
+const std::string WAL_FAILED_MSG = "WriteAheadLog ERROR: An earlier write failed, the log has to be reopened";
+
+struct WalRecord {
+    enum class Kind : uint8_t {
+        ADD_DOCUMENT,
+        REMOVE_DOCUMENT,
+    };
+    Kind kind = Kind::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+    int replaced_document_id = -1; //ADD_DOCUMENT: stored duplicate removed by the addition, or -1
+    uint64_t sequence_number = 0; //assigned by WriteAheadLog::Append, starts at 1
+};
+
+//************* Class Write-Ahead Log *************//
+// Append-only log of index modifications. A record is encoded as
+// [payload size][FNV-1a checksum][payload], so a torn write at the end is detected on replay.
+// Records are numbered in the order they are appended, continuing after the last record of an
+// existing file; a server remembers the number of the last change it applied (see ReplayWriteAheadLog).
+// Concurrent Append calls are group-committed: the first waiting writer becomes the leader,
+// writes everything queued so far with one write and one fsync, and wakes up the others.
+// A failed write is sticky: every record of the failed batch and after it fails, and so does
+// every later Append, as the file may now end with a torn record. Opening the file again
+// truncates a torn tail, so records appended after it are not lost on replay.
+class WriteAheadLog {
+public:
+    //opens or creates the file for appending, sync = false skips fsync (for tests & benchmarks)
+    explicit WriteAheadLog(const std::string& path, bool sync = true);
+    //takes over an open descriptor, e.g. a pipe; nothing is read or truncated
+    WriteAheadLog(int file_descriptor, bool sync);
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    //returns the sequence number once the record is on disk,
+    //throws std::runtime_error if it cannot get there
+    uint64_t Append(WalRecord record);
+    //Append in two steps, so the caller can number records under its own lock and wait outside it;
+    //Enqueue does not throw, a failed log drops the record and WaitDurable throws
+    uint64_t Enqueue(WalRecord record);
+    void WaitDurable(uint64_t sequence_number);
+    bool IsFailed() const;
+    uint64_t GetRecordCount() const;
+    uint64_t GetSyncCount() const;
+
+private:
+    int file_descriptor_ = -1;
+    bool sync_ = true;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::string pending_;            //encoded records not yet written
+    uint64_t last_sequence_number_ = 0;
+    uint64_t durable_sequence_number_ = 0;
+    uint64_t pending_records_ = 0;
+    uint64_t durable_records_ = 0;
+    uint64_t sync_count_ = 0;
+    bool is_flushing_ = false;
+    bool is_failed_ = false;
+
+    void WriteAndSync(const std::string& data);
+};
+
+std::string EncodeWalRecord(const WalRecord& record);
+//decodes all complete records with a valid checksum, stopping at the first damaged one;
+//checksums and payloads are decoded on the thread pool
+std::vector<WalRecord> ReadWriteAheadLog(const std::string& path, ThreadPool& thread_pool = GetDefaultThreadPool());
+// Applies the log on top of a server restored from a snapshot: only records numbered after
+// server.GetLogSequenceNumber() are applied, so a snapshot taken at any point, or a server that
+// already replayed the log, ends up in the same state. The server must not have a log attached.
+// Returns the number of applied records.
+size_t ReplayWriteAheadLog(const std::string& path, SearchServer& server, ThreadPool& thread_pool = GetDefaultThreadPool());